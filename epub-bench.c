@@ -0,0 +1,344 @@
+#include <string.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <zip.h>
+
+#include "epub-bench.h"
+#include "epub-format.h"
+#include "epub-reader.h"
+
+/* Kept alive until zip_close(), libzip reads sources only then */
+typedef struct {
+    zip_t *za;
+    GPtrArray *buffers;
+} ZipWriter;
+
+static char *random_text(GRand *rand, guint n_words);
+static char *random_name(GRand *rand);
+static gboolean write_epub(const char *path, GRand *rand, guint book, GError **error);
+static gboolean write_fb2(const char *path, GRand *rand, guint book, gboolean zipped,
+                          GError **error);
+static void bench_worker(gpointer data, gpointer user_data);
+
+/* Some Cyrillic, so the UTF-8 paths of the parsers are trained too */
+static const char *const words[] = {
+    "war", "peace", "anna", "river", "night", "letters", "garden", "winter",
+    "the", "of", "and", "a", "house", "city", "light", "storm", "journey",
+    "война", "мир", "сад", "ночь", "река", "зима", "письма", "дом",
+};
+
+static const char *const first_names[] = {
+    "Leo", "Anna", "Fyodor", "Jane", "Mark", "Virginia", "Иван", "Мария",
+};
+
+static const char *const last_names[] = {
+    "Tolstoy", "Austen", "Twain", "Woolf", "Dostoevsky", "Тургенев", "Чехова",
+};
+
+static const char *const langs[] = {"en", "ru", "en-GB", "de", "fr"};
+
+#define PICK(rand, array) \
+    ((array)[g_rand_int_range((rand), 0, G_N_ELEMENTS(array))])
+
+static char *
+random_text(GRand *rand, guint n_words)
+{
+    GString *out = g_string_new("");
+    for(guint i = 0; i < n_words; ++i) {
+        if(i > 0)
+            g_string_append_c(out, ' ');
+        g_string_append(out, PICK(rand, words));
+    }
+    return g_string_free(out, FALSE);
+}
+
+static char *
+random_name(GRand *rand)
+{
+    return g_strdup_printf("%s %s", PICK(rand, first_names),
+                           PICK(rand, last_names));
+}
+
+/* A few chapters of 4 to 16 KiB, about what a short book compresses like */
+static char *
+random_paragraphs(GRand *rand, const char *open, const char *close)
+{
+    GString *out = g_string_new("");
+    const guint n = g_rand_int_range(rand, 40, 160);
+    for(guint i = 0; i < n; ++i) {
+        char *text = random_text(rand, g_rand_int_range(rand, 8, 30));
+        g_string_append_printf(out, "%s%s%s\n", open, text, close);
+        g_free(text);
+    }
+    return g_string_free(out, FALSE);
+}
+
+static gboolean
+zip_writer_add(ZipWriter *w, const char *name, char *data, gboolean store,
+               GError **error)
+{
+    g_ptr_array_add(w->buffers, data);
+    zip_source_t *src = zip_source_buffer(w->za, data, strlen(data), 0);
+    zip_int64_t index = src ? zip_file_add(w->za, name, src, ZIP_FL_OVERWRITE) : -1;
+    if(index < 0) {
+        if(src)
+            zip_source_free(src);
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_FAILED, "%s: %s", name,
+                    zip_strerror(w->za));
+        return FALSE;
+    }
+    if(store)
+        zip_set_file_compression(w->za, (zip_uint64_t)index, ZIP_CM_STORE, 0);
+    return TRUE;
+}
+
+static gboolean
+zip_writer_open(ZipWriter *w, const char *path, GError **error)
+{
+    int err = 0;
+    w->za = zip_open(path, ZIP_CREATE | ZIP_TRUNCATE, &err);
+    if(!w->za) {
+        char errbuf[256];
+        zip_error_to_str(errbuf, sizeof(errbuf), err, 0);
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_FAILED, "%s: %s", path,
+                    errbuf);
+        return FALSE;
+    }
+    w->buffers = g_ptr_array_new_with_free_func(g_free);
+    return TRUE;
+}
+
+static gboolean
+zip_writer_close(ZipWriter *w, gboolean ok, const char *path, GError **error)
+{
+    if(!ok)
+        zip_discard(w->za);
+    else if(zip_close(w->za) != 0) {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_FAILED, "%s: %s", path,
+                    zip_strerror(w->za));
+        zip_discard(w->za);
+        ok = FALSE;
+    }
+    g_ptr_array_unref(w->buffers);
+    return ok;
+}
+
+static gboolean
+write_epub(const char *path, GRand *rand, guint book, GError **error)
+{
+    ZipWriter w;
+    if(!zip_writer_open(&w, path, error))
+        return FALSE;
+    /* OCF: stored mimetype first, that is what the sniffer looks for */
+    gboolean ok = zip_writer_add(&w, "mimetype", g_strdup("application/epub+zip"),
+                                 TRUE, error)
+        && zip_writer_add(&w, "META-INF/container.xml", g_strdup(
+            "<?xml version=\"1.0\"?>\n"
+            "<container version=\"1.0\" xmlns=\"urn:oasis:names:tc:opendocument:xmlns:container\">\n"
+            "  <rootfiles>\n"
+            "    <rootfile full-path=\"OEBPS/content.opf\" media-type=\"application/oebps-package+xml\"/>\n"
+            "  </rootfiles>\n"
+            "</container>\n"), FALSE, error);
+
+    const guint n_chapters = g_rand_int_range(rand, 2, 9);
+    GString *opf = g_string_new(
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<package xmlns=\"http://www.idpf.org/2007/opf\" version=\"3.0\" unique-identifier=\"id\">\n"
+        "  <metadata xmlns:dc=\"http://purl.org/dc/elements/1.1/\">\n");
+    char *title = random_text(rand, g_rand_int_range(rand, 1, 7));
+    g_string_append_printf(opf, "    <dc:title>%s</dc:title>\n", title);
+    g_free(title);
+    const guint n_creators = g_rand_int_range(rand, 1, 4);
+    for(guint i = 0; i < n_creators; ++i) {
+        char *name = random_name(rand);
+        g_string_append_printf(opf, "    <dc:creator>%s</dc:creator>\n", name);
+        g_free(name);
+    }
+    g_string_append_printf(opf,
+        "    <dc:language>%s</dc:language>\n"
+        "    <dc:identifier id=\"id\">urn:uuid:%08x-0000-4000-8000-%012x</dc:identifier>\n"
+        "    <meta property=\"dcterms:modified\">2020-01-01T00:00:00Z</meta>\n"
+        "  </metadata>\n  <manifest>\n",
+        PICK(rand, langs), g_rand_int(rand), book);
+    for(guint i = 0; i < n_chapters; ++i)
+        g_string_append_printf(opf,
+            "    <item id=\"ch%u\" href=\"ch%u.xhtml\" media-type=\"application/xhtml+xml\"/>\n",
+            i, i);
+    g_string_append(opf, "  </manifest>\n  <spine>\n");
+    for(guint i = 0; i < n_chapters; ++i)
+        g_string_append_printf(opf, "    <itemref idref=\"ch%u\"/>\n", i);
+    g_string_append(opf, "  </spine>\n</package>\n");
+    ok = ok && zip_writer_add(&w, "OEBPS/content.opf", g_string_free(opf, FALSE),
+                              FALSE, error);
+
+    for(guint i = 0; ok && i < n_chapters; ++i) {
+        char *body = random_paragraphs(rand, "<p>", "</p>");
+        char *xhtml = g_strdup_printf(
+            "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            "<html xmlns=\"http://www.w3.org/1999/xhtml\"><head><title>%u</title></head>\n"
+            "<body>\n%s</body></html>\n", i, body);
+        char *name = g_strdup_printf("OEBPS/ch%u.xhtml", i);
+        g_free(body);
+        ok = zip_writer_add(&w, name, xhtml, FALSE, error);
+        g_free(name);
+    }
+    return zip_writer_close(&w, ok, path, error);
+}
+
+static char *
+fb2_document(GRand *rand, guint book)
+{
+    GString *out = g_string_new(
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<FictionBook xmlns=\"http://www.gribuser.ru/xml/fictionbook/2.0\">\n"
+        "<description>\n<title-info>\n");
+    const guint n_authors = g_rand_int_range(rand, 1, 3);
+    for(guint i = 0; i < n_authors; ++i)
+        g_string_append_printf(out,
+            "  <author><first-name>%s</first-name><last-name>%s</last-name></author>\n",
+            PICK(rand, first_names), PICK(rand, last_names));
+    char *title = random_text(rand, g_rand_int_range(rand, 1, 7));
+    g_string_append_printf(out,
+        "  <book-title>%s</book-title>\n  <lang>%s</lang>\n</title-info>\n"
+        "<document-info><id>fb2-%u-%08x</id></document-info>\n"
+        "</description>\n<body>\n",
+        title, PICK(rand, langs), book, g_rand_int(rand));
+    g_free(title);
+    const guint n_sections = g_rand_int_range(rand, 2, 9);
+    for(guint i = 0; i < n_sections; ++i) {
+        char *body = random_paragraphs(rand, "<p>", "</p>");
+        g_string_append_printf(out, "<section>\n%s</section>\n", body);
+        g_free(body);
+    }
+    g_string_append(out, "</body>\n</FictionBook>\n");
+    return g_string_free(out, FALSE);
+}
+
+static gboolean
+write_fb2(const char *path, GRand *rand, guint book, gboolean zipped,
+          GError **error)
+{
+    char *document = fb2_document(rand, book);
+    if(!zipped) {
+        const gboolean ok = g_file_set_contents(path, document, -1, error);
+        g_free(document);
+        return ok;
+    }
+    ZipWriter w;
+    if(!zip_writer_open(&w, path, error)) {
+        g_free(document);
+        return FALSE;
+    }
+    char *name = g_path_get_basename(path);
+    /* book.fb2.zip holds book.fb2 */
+    name[strlen(name) - 4] = '\0';
+    const gboolean ok = zip_writer_add(&w, name, document, FALSE, error);
+    g_free(name);
+    return zip_writer_close(&w, ok, path, error);
+}
+
+gboolean
+epub_bench_make_corpus(const char *dir, guint n_books, guint32 seed,
+                       GError **error)
+{
+    if(g_mkdir_with_parents(dir, 0755) != 0) {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                    "cannot create %s", dir);
+        return FALSE;
+    }
+    GRand *rand = g_rand_new_with_seed(seed);
+    gboolean ok = TRUE;
+    for(guint i = 0; ok && i < n_books; ++i) {
+        /* Roughly the mix of our collections */
+        const guint kind = g_rand_int_range(rand, 0, 10);
+        const char *suffix = kind < 7 ? "epub" : kind < 9 ? "fb2" : "fb2.zip";
+        char *name = g_strdup_printf("book-%05u.%s", i, suffix);
+        char *path = g_build_filename(dir, name, NULL);
+        ok = kind < 7 ? write_epub(path, rand, i, error)
+                      : write_fb2(path, rand, i, kind == 9, error);
+        g_free(path);
+        g_free(name);
+    }
+    g_rand_free(rand);
+    return ok;
+}
+
+/* Benchmark */
+
+typedef struct {
+    const char *path;
+    int status;
+} BenchBook;
+
+static void
+bench_worker(gpointer data, gpointer user_data)
+{
+    BenchBook *book = data;
+    EpubRecord *record;
+    book->status = read_book(book->path, NULL, &record);
+    g_free(record);
+}
+
+gboolean
+epub_bench_run(const char *dir, guint rounds, guint n_threads,
+               EpubBenchResult *result, GError **error)
+{
+    memset(result, 0, sizeof(EpubBenchResult));
+    GDir *d = g_dir_open(dir, 0, error);
+    if(!d)
+        return FALSE;
+    GPtrArray *paths = g_ptr_array_new_with_free_func(g_free);
+    const char *name;
+    while((name = g_dir_read_name(d)) != NULL) {
+        if(!epub_format_has_suffix(name))
+            continue;
+        char *path = g_build_filename(dir, name, NULL);
+        GStatBuf st;
+        if(g_stat(path, &st) == 0 && S_ISREG(st.st_mode)) {
+            result->bytes += st.st_size;
+            g_ptr_array_add(paths, path);
+        } else {
+            g_free(path);
+        }
+    }
+    g_dir_close(d);
+    if(paths->len == 0) {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_NOENT,
+                    "no books in %s", dir);
+        g_ptr_array_unref(paths);
+        return FALSE;
+    }
+
+    if(n_threads == 0)
+        n_threads = g_get_num_processors();
+    if(rounds == 0)
+        rounds = 1;
+    BenchBook *books = g_new0(BenchBook, paths->len);
+    for(guint i = 0; i < paths->len; ++i)
+        books[i].path = g_ptr_array_index(paths, i);
+    result->n_books = paths->len;
+    result->rounds = rounds;
+    gdouble total = 0;
+    for(guint round = 0; round < rounds; ++round) {
+        const gint64 start = g_get_monotonic_time();
+        GThreadPool *pool = g_thread_pool_new(bench_worker, NULL, n_threads,
+                                              TRUE, NULL);
+        for(guint i = 0; i < paths->len; ++i)
+            g_thread_pool_push(pool, &books[i], NULL);
+        g_thread_pool_free(pool, FALSE, TRUE);
+        const gdouble seconds = (g_get_monotonic_time() - start) / 1e6;
+        total += seconds;
+        if(round == 0 || seconds < result->best_seconds)
+            result->best_seconds = seconds;
+    }
+    result->mean_seconds = total / rounds;
+    for(guint i = 0; i < paths->len; ++i) {
+        if(books[i].status != EPUB_OK)
+            ++result->n_failed;
+    }
+    g_free(books);
+    g_ptr_array_unref(paths);
+    return TRUE;
+}
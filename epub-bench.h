@@ -0,0 +1,29 @@
+#ifndef _EPUB_BENCH_
+#define _EPUB_BENCH_
+
+#include <glib.h>
+
+/* Parse throughput benchmark over a synthetic corpus. It is the training
+   workload of the PGO build (make pgo) and what make pgo-report compares,
+   so it only exercises the code the extension runs per book. */
+
+typedef struct {
+    guint n_books;      /* per round */
+    guint n_failed;
+    guint64 bytes;      /* file sizes, per round */
+    guint rounds;
+    gdouble best_seconds;
+    gdouble mean_seconds;
+} EpubBenchResult;
+
+/* Writes n_books EPUB, FB2 and zipped FB2 files with random metadata and
+   a few chapters of text into dir. The same seed gives the same corpus. */
+gboolean epub_bench_make_corpus(const char *dir, guint n_books, guint32 seed,
+                                GError **error);
+
+/* Reads every book in dir (not recursive) rounds times with n_threads
+   workers, 0 meaning one per CPU. */
+gboolean epub_bench_run(const char *dir, guint rounds, guint n_threads,
+                        EpubBenchResult *result, GError **error);
+
+#endif /* _EPUB_BENCH_ */
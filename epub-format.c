@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "epub-format.h"
+#include "epub-stats.h"
+
+static gboolean sniff_epub(const guint8 *head, gsize len);
+static gboolean sniff_fb2_zip(const guint8 *head, gsize len);
+static gboolean sniff_fb2(const guint8 *head, gsize len);
+
+static const char *const epub_mime_types[] = {"application/epub+zip", NULL};
+static const char *const epub_suffixes[] = {".epub", NULL};
+static const char *const fb2_zip_mime_types[] = {"application/x-zip-compressed-fb2",
+                                                 NULL};
+static const char *const fb2_zip_suffixes[] = {".fb2.zip", ".fbz", NULL};
+static const char *const fb2_mime_types[] = {"application/x-fictionbook+xml",
+                                             "application/x-fictionbook", NULL};
+static const char *const fb2_suffixes[] = {".fb2", NULL};
+
+/* Generic types that may hide one of ours */
+static const char *const ambiguous_mime_types[] = {"application/zip",
+                                                   "application/xml",
+                                                   "text/xml", NULL};
+
+static const EpubFormat formats[] = {
+    {"epub", epub_mime_types, epub_suffixes, TRUE, sniff_epub,
+     read_from_epub, read_from_epub_stream},
+    {"fb2.zip", fb2_zip_mime_types, fb2_zip_suffixes, TRUE, sniff_fb2_zip,
+     read_from_fb2_zip, read_from_fb2_zip_stream},
+    {"fb2", fb2_mime_types, fb2_suffixes, FALSE, sniff_fb2,
+     read_from_fb2, read_from_fb2_stream},
+};
+
+/* Name and data offset of the first local file header */
+static gboolean
+zip_first_entry(const guint8 *head, gsize len, const char **name,
+                gsize *name_len, gsize *data_offset)
+{
+    if(len < 30 || memcmp(head, "PK\3\4", 4) != 0)
+        return FALSE;
+    *name_len = head[26] | head[27] << 8;
+    const gsize extra_len = head[28] | head[29] << 8;
+    if(30 + *name_len > len)
+        return FALSE;
+    *name = (const char *)head + 30;
+    *data_offset = 30 + *name_len + extra_len;
+    return TRUE;
+}
+
+/* OCF: the first member is "mimetype", stored, so its content sits at
+   offset 38 right after the name */
+static gboolean
+sniff_epub(const guint8 *head, gsize len)
+{
+    static const char mimetype[] = "application/epub+zip";
+    const char *name;
+    gsize name_len, data_offset;
+    if(!zip_first_entry(head, len, &name, &name_len, &data_offset))
+        return FALSE;
+    const guint method = head[8] | head[9] << 8;
+    return method == 0 && name_len == 8 && memcmp(name, "mimetype", 8) == 0
+           && data_offset + sizeof(mimetype) - 1 <= len
+           && memcmp(head + data_offset, mimetype, sizeof(mimetype) - 1) == 0;
+}
+
+static gboolean
+sniff_fb2_zip(const guint8 *head, gsize len)
+{
+    const char *name;
+    gsize name_len, data_offset;
+    if(!zip_first_entry(head, len, &name, &name_len, &data_offset))
+        return FALSE;
+    return name_len > 4 && g_ascii_strncasecmp(name + name_len - 4, ".fb2", 4) == 0;
+}
+
+/* The root element follows the XML declaration and maybe a comment */
+static gboolean
+sniff_fb2(const guint8 *head, gsize len)
+{
+    return g_strstr_len((const char *)head, len, "<FictionBook") != NULL;
+}
+
+static gboolean
+in_list(const char *const *list, const char *value)
+{
+    for(; value && *list; ++list) {
+        if(g_ascii_strcasecmp(*list, value) == 0)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+const EpubFormat *
+epub_format_sniff(const guint8 *head, gsize len, const char *mime_hint)
+{
+    for(size_t i = 0; i < G_N_ELEMENTS(formats); ++i) {
+        if(formats[i].sniff(head, len))
+            return &formats[i];
+    }
+    /* e.g. an EPUB whose mimetype member is not first */
+    for(size_t i = 0; i < G_N_ELEMENTS(formats); ++i) {
+        if(in_list(formats[i].mime_types, mime_hint))
+            return &formats[i];
+    }
+    return NULL;
+}
+
+gboolean
+epub_format_is_candidate(const char *mime_type)
+{
+    return in_list(ambiguous_mime_types, mime_type)
+           || epub_format_is_book_type(mime_type);
+}
+
+gboolean
+epub_format_is_book_type(const char *mime_type)
+{
+    for(size_t i = 0; i < G_N_ELEMENTS(formats); ++i) {
+        if(in_list(formats[i].mime_types, mime_type))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+gboolean
+epub_format_has_suffix(const char *filename)
+{
+    return epub_format_for_suffix(filename) != NULL;
+}
+
+const EpubFormat *
+epub_format_for_suffix(const char *filename)
+{
+    const size_t len = strlen(filename);
+    for(size_t i = 0; i < G_N_ELEMENTS(formats); ++i) {
+        for(const char *const *suffix = formats[i].suffixes; *suffix; ++suffix) {
+            const size_t suffix_len = strlen(*suffix);
+            if(len > suffix_len
+               && g_ascii_strcasecmp(filename + len - suffix_len, *suffix) == 0)
+                return &formats[i];
+        }
+    }
+    return NULL;
+}
+
+const char *
+epub_format_suffix_hint(const char *filename)
+{
+    const EpubFormat *format = epub_format_for_suffix(filename);
+    return format ? format->mime_types[0] : NULL;
+}
+
+/* A record that only carries message as its title */
+static int
+fail(int result, const char *message, EpubRecord **record)
+{
+    *record = epub_record_new(message, NULL, NULL, 0, NULL, 0, 0, 0);
+    epub_stats_add(EPUB_STAT_BOOKS, 1);
+    epub_stats_add(EPUB_STAT_ERRORS, 1);
+    return result;
+}
+
+const EpubFormat *
+epub_format_sniff_path(const char *path, const char *mime_hint)
+{
+    guint8 head[EPUB_SNIFF_LEN];
+    gsize len = 0;
+    FILE *f = fopen(path, "rb");
+    if(f) {
+        len = fread(head, 1, sizeof(head), f);
+        fclose(f);
+    }
+    return epub_format_sniff(head, len, mime_hint);
+}
+
+int
+read_book(const char *path, const char *mime_hint, EpubRecord **record)
+{
+    const EpubFormat *format = epub_format_sniff_path(path, mime_hint);
+    if(!format)
+        return fail(EPUB_ERR_FORMAT, NULL, record);
+    return format->read(path, record);
+}
+
+int
+read_book_stream(GInputStream *stream, goffset size, const char *mime_hint,
+                 GCancellable *cancellable, EpubRecord **record,
+                 EpubIoStats *io)
+{
+    /* Peek at the head instead of rewinding, so a plain FB2 can come from
+       a stream that can't seek. The archive readers get stream itself,
+       their zip source seeks to whatever it needs. */
+    GInputStream *buffered = g_buffered_input_stream_new_sized(
+        stream, EPUB_STREAM_WINDOW);
+    g_filter_input_stream_set_close_base_stream(G_FILTER_INPUT_STREAM(buffered),
+                                                FALSE);
+    GBufferedInputStream *peek = G_BUFFERED_INPUT_STREAM(buffered);
+    guint round_trips = 0;
+    gssize n;
+    do {
+        n = g_buffered_input_stream_fill(peek, EPUB_SNIFF_LEN
+                                         - g_buffered_input_stream_get_available(peek),
+                                         cancellable, NULL);
+        ++round_trips;
+    } while(n > 0 && g_buffered_input_stream_get_available(peek) < EPUB_SNIFF_LEN);
+    if(n < 0) {
+        g_object_unref(buffered);
+        return fail(EPUB_ERR_ZIP_OPEN, "cannot read stream", record);
+    }
+    gsize len = 0;
+    const guint8 *head = g_buffered_input_stream_peek_buffer(peek, &len);
+    const EpubFormat *format = epub_format_sniff(head, MIN(len, EPUB_SNIFF_LEN),
+                                                 mime_hint);
+    int result;
+    if(!format) {
+        result = fail(EPUB_ERR_FORMAT, NULL, record);
+    } else if(format->archive) {
+        if(io) {
+            io->bytes_read += len;
+            io->round_trips += round_trips;
+        }
+        result = format->read_stream(stream, size, cancellable, record, io);
+    } else {
+        /* The reader is served the head from the buffer and counts it */
+        result = format->read_stream(buffered, size, cancellable, record, io);
+    }
+    g_object_unref(buffered);
+    return result;
+}
+
+int
+read_book_file(GFile *file, const char *mime_hint, GCancellable *cancellable,
+               EpubRecord **record, EpubIoStats *io)
+{
+    GError *error = NULL;
+    goffset size = 0;
+    GInputStream *stream = epub_file_read(file, cancellable, &size, &error);
+    if(!stream) {
+        const int result = fail(EPUB_ERR_ZIP_OPEN, error->message, record);
+        g_error_free(error);
+        return result;
+    }
+    const int result = read_book_stream(stream, size, mime_hint, cancellable,
+                                        record, io);
+    g_object_unref(stream);
+    return result;
+}
@@ -0,0 +1,57 @@
+#ifndef _EPUB_FORMAT_
+#define _EPUB_FORMAT_
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "epub-reader.h"
+
+/* Book formats, told apart by the first bytes of the file rather than by
+   name or MIME type. Every handler returns the same EpubRecord, so callers
+   (the module's worker pool, the library index) do not care which one
+   ran. Detection costs one read of EPUB_SNIFF_LEN bytes. */
+
+#define EPUB_SNIFF_LEN 512
+
+typedef struct {
+    const char *name;
+    const char *const *mime_types;  /* NULL terminated */
+    const char *const *suffixes;    /* NULL terminated, lower case */
+    gboolean archive;               /* a ZIP, see epub-verify.h */
+    gboolean (*sniff)(const guint8 *head, gsize len);
+    int (*read)(const char *path, EpubRecord **record);
+    int (*read_stream)(GInputStream *stream, goffset size,
+                       GCancellable *cancellable, EpubRecord **record,
+                       EpubIoStats *io);
+} EpubFormat;
+
+/* The handler whose magic matches head; failing that, the one that
+   claims mime_hint (may be NULL). NULL if neither. */
+const EpubFormat *epub_format_sniff(const guint8 *head, gsize len,
+                                    const char *mime_hint);
+/* Reads the head of path and sniffs it */
+const EpubFormat *epub_format_sniff_path(const char *path, const char *mime_hint);
+/* Files of this MIME type are worth a sniff */
+gboolean epub_format_is_candidate(const char *mime_type);
+/* A type one of the formats claims. Candidates that are not, like
+   application/zip, are books only if the sniffer says so. */
+gboolean epub_format_is_book_type(const char *mime_type);
+/* Files with this name are worth a sniff when scanning a tree */
+gboolean epub_format_has_suffix(const char *filename);
+/* The handler that claims the suffix of filename, or NULL */
+const EpubFormat *epub_format_for_suffix(const char *filename);
+/* Its MIME type, the sniffer's fallback when there is no desktop MIME
+   type at hand, e.g. for an EPUB whose mimetype member is not first */
+const char *epub_format_suffix_hint(const char *filename);
+
+/* Sniff and read; EPUB_ERR_FORMAT when no handler matches. Like the
+   read_from_*() functions *record is always set. */
+int read_book(const char *path, const char *mime_hint, EpubRecord **record);
+int read_book_stream(GInputStream *stream, goffset size, const char *mime_hint,
+                     GCancellable *cancellable, EpubRecord **record,
+                     EpubIoStats *io);
+int read_book_file(GFile *file, const char *mime_hint,
+                   GCancellable *cancellable, EpubRecord **record,
+                   EpubIoStats *io);
+
+#endif /* _EPUB_FORMAT_ */
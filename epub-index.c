@@ -0,0 +1,660 @@
+#define _DEFAULT_SOURCE
+#include <string.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "epub-format.h"
+#include "epub-reader.h"
+#include "epub-index.h"
+#include "epub-stats.h"
+#include "epub-verify.h"
+
+struct _EpubIndex {
+    GMappedFile *mapped;
+    const EpubIndexHeader *header;
+    const EpubIndexRecord *records;
+    const EpubIndexKey *creator_keys;
+    const EpubIndexKey *lang_keys;
+    const EpubIndexKey *identifier_keys;
+    const char *books;
+    const char *strings;
+};
+
+/* One book while the index is being built */
+typedef struct {
+    char *path;
+    gint64 mtime;
+    gint64 size;
+    int status;
+    guint32 flags;    /* EpubIndexRecordFlags */
+    gboolean verify;  /* check the archive in scan_worker() */
+    EpubRecord *book;
+    gint64 queued_at;
+} ScanEntry;
+
+/* String table under construction */
+typedef struct {
+    GString *data;
+    GHashTable *offsets; /* string -> GUINT_TO_POINTER(offset) */
+} StringTable;
+
+static gboolean scan_directory(const char *dir, GPtrArray *entries,
+                               GError **error);
+static void scan_entry_free(gpointer data);
+static void scan_worker(gpointer data, gpointer user_data);
+static gboolean write_index(const char *index_file, GPtrArray *entries,
+                            GError **error);
+static guint32 string_table_add(StringTable *table, const char *str);
+static guint32 string_table_add_key(StringTable *table, const char *str);
+static const EpubRecord *index_book(const EpubIndex *index,
+                                    const EpubIndexRecord *record);
+
+/* Building */
+
+gboolean
+epub_index_update(const char *root, const char *index_file,
+                  guint n_threads, EpubIndexFlags flags,
+                  EpubIndexStats *stats, GError **error)
+{
+    EpubIndexStats local_stats;
+    if(!stats)
+        stats = &local_stats;
+    memset(stats, 0, sizeof(EpubIndexStats));
+
+    GPtrArray *entries = g_ptr_array_new_with_free_func(scan_entry_free);
+    /* A missing root must not replace a good index with an empty one */
+    if(!scan_directory(root, entries, error)) {
+        g_ptr_array_unref(entries);
+        return FALSE;
+    }
+    stats->n_files = entries->len;
+
+    /* A missing or unreadable old index simply means a full rescan */
+    EpubIndex *old = epub_index_open(index_file, NULL);
+    GHashTable *previous = g_hash_table_new(g_str_hash, g_str_equal);
+    if(old) {
+        for(guint i = 0; i < epub_index_get_n_entries(old); ++i) {
+            const EpubIndexRecord *record = epub_index_get_record(old, i);
+            g_hash_table_insert(previous,
+                                (gpointer)epub_index_get_string(old, record->path),
+                                (gpointer)record);
+        }
+    }
+
+    if(n_threads == 0)
+        n_threads = g_get_num_processors();
+    GThreadPool *pool = g_thread_pool_new(scan_worker, NULL, n_threads,
+                                          TRUE, NULL);
+    for(guint i = 0; i < entries->len; ++i) {
+        ScanEntry *entry = g_ptr_array_index(entries, i);
+        const EpubIndexRecord *record = g_hash_table_lookup(previous, entry->path);
+        const EpubRecord *book = record ? index_book(old, record) : NULL;
+        if(book && record->mtime == entry->mtime && record->size == entry->size) {
+            entry->status = record->status;
+            entry->flags = record->flags;
+            entry->book = epub_record_copy(book);
+            ++stats->n_reused;
+            epub_stats_add(EPUB_STAT_CACHE_HITS, 1);
+            if((flags & EPUB_INDEX_VERIFY) && entry->status == EPUB_OK
+               && !(entry->flags & EPUB_INDEX_RECORD_VERIFIED)) {
+                entry->verify = TRUE;
+                entry->queued_at = epub_stats_now();
+                g_thread_pool_push(pool, entry, NULL);
+            }
+        } else {
+            entry->verify = (flags & EPUB_INDEX_VERIFY) != 0;
+            entry->queued_at = epub_stats_now();
+            g_thread_pool_push(pool, entry, NULL);
+            ++stats->n_parsed;
+            epub_stats_add(EPUB_STAT_CACHE_MISSES, 1);
+        }
+    }
+    /* Wait for the queue to drain */
+    g_thread_pool_free(pool, FALSE, TRUE);
+    g_hash_table_destroy(previous);
+    if(old)
+        epub_index_close(old);
+
+    for(guint i = 0; i < entries->len; ++i) {
+        ScanEntry *entry = g_ptr_array_index(entries, i);
+        if(entry->status != EPUB_OK)
+            ++stats->n_failed;
+        if(entry->verify && (entry->flags & EPUB_INDEX_RECORD_VERIFIED)) {
+            ++stats->n_verified;
+            if(entry->status == EPUB_ERR_CORRUPT)
+                ++stats->n_corrupt;
+        }
+    }
+    gboolean ok = write_index(index_file, entries, error);
+    g_ptr_array_unref(entries);
+    return ok;
+}
+
+/* Only fails if dir itself can't be opened, unreadable subdirectories
+   are skipped */
+static gboolean
+scan_directory(const char *dir, GPtrArray *entries, GError **error)
+{
+    GDir *d = g_dir_open(dir, 0, error);
+    if(!d)
+        return FALSE;
+    const char *name;
+    while((name = g_dir_read_name(d)) != NULL) {
+        char *path = g_build_filename(dir, name, NULL);
+        GStatBuf st;
+        if(g_lstat(path, &st) != 0) {
+            g_free(path);
+            continue;
+        }
+        /* Do not follow links into directories, that is how loops happen */
+        if(S_ISLNK(st.st_mode)
+           && (g_stat(path, &st) != 0 || S_ISDIR(st.st_mode))) {
+            g_free(path);
+            continue;
+        }
+        if(S_ISDIR(st.st_mode)) {
+            scan_directory(path, entries, NULL);
+            g_free(path);
+            continue;
+        }
+        /* Content is sniffed on read, the name only keeps the scan off
+           files that are certainly not books */
+        if(!S_ISREG(st.st_mode) || !epub_format_has_suffix(name)) {
+            g_free(path);
+            continue;
+        }
+        ScanEntry *entry = g_new0(ScanEntry, 1);
+        entry->path = path;
+        entry->mtime = st.st_mtime;
+        entry->size = st.st_size;
+        g_ptr_array_add(entries, entry);
+    }
+    g_dir_close(d);
+    return TRUE;
+}
+
+static void
+scan_entry_free(gpointer data)
+{
+    ScanEntry *entry = data;
+    g_free(entry->path);
+    g_free(entry->book);
+    g_free(entry);
+}
+
+static void
+scan_read(ScanEntry *entry)
+{
+    EpubRecord *book;
+    entry->status = read_book(entry->path,
+                              epub_format_suffix_hint(entry->path), &book);
+    if(entry->status == EPUB_OK) {
+        entry->book = book;
+        return;
+    }
+    /* Keep the fingerprint, so damaged copies still group, but not
+       whatever half of the metadata was read or the error text */
+    entry->book = epub_record_new(NULL, NULL, NULL, 0, NULL, 0, 0,
+                                  book->content_hash);
+    g_free(book);
+}
+
+/* Only books that parsed; the result sticks until the file changes */
+static void
+scan_verify(ScanEntry *entry)
+{
+    const EpubFormat *format = epub_format_sniff_path(
+        entry->path, epub_format_suffix_hint(entry->path));
+    if(format && format->archive) {
+        EpubVerifyResult result;
+        epub_verify_archive(entry->path, &result);
+        if(result.status != EPUB_OK)
+            entry->status = result.status;
+        epub_verify_result_clear(&result);
+    }
+    entry->flags |= EPUB_INDEX_RECORD_VERIFIED;
+}
+
+/* Runs in the thread pool; every task owns its entry, so no locking.
+   Reused entries only come here to be verified. */
+static void
+scan_worker(gpointer data, gpointer user_data)
+{
+    ScanEntry *entry = data;
+    epub_stats_record_since(EPUB_STAT_QUEUE_WAIT, entry->queued_at);
+    if(!entry->book)
+        scan_read(entry);
+    if(entry->verify && entry->status == EPUB_OK)
+        scan_verify(entry);
+}
+
+/* Serialization */
+
+static guint32
+string_table_add(StringTable *table, const char *str)
+{
+    if(!str || !*str)
+        return 0;
+    gpointer offset;
+    if(g_hash_table_lookup_extended(table->offsets, str, NULL, &offset))
+        return GPOINTER_TO_UINT(offset);
+    const guint32 result = (guint32)table->data->len;
+    g_string_append_len(table->data, str, strlen(str) + 1);
+    g_hash_table_insert(table->offsets, g_strdup(str), GUINT_TO_POINTER(result));
+    return result;
+}
+
+static guint32
+string_table_add_key(StringTable *table, const char *str)
+{
+    char *folded = g_utf8_casefold(str, -1);
+    const guint32 result = string_table_add(table, folded);
+    g_free(folded);
+    return result;
+}
+
+static gint
+compare_scan_entries(gconstpointer a, gconstpointer b)
+{
+    const ScanEntry *lhs = *(const ScanEntry **)a;
+    const ScanEntry *rhs = *(const ScanEntry **)b;
+    return strcmp(lhs->path, rhs->path);
+}
+
+static gint
+compare_keys(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+    const StringTable *table = user_data;
+    const EpubIndexKey *lhs = a;
+    const EpubIndexKey *rhs = b;
+    const int r = strcmp(table->data->str + lhs->key, table->data->str + rhs->key);
+    if(r != 0)
+        return r;
+    return lhs->entry < rhs->entry ? -1 : lhs->entry > rhs->entry;
+}
+
+/* One key per item of a record list */
+static void
+add_list_keys(StringTable *table, GArray *keys, const char *list,
+              guint n, guint32 entry)
+{
+    for(guint i = 0; i < n; ++i, list = epub_record_next(list)) {
+        EpubIndexKey key = {string_table_add_key(table, list), entry};
+        g_array_append_val(keys, key);
+    }
+}
+
+static gboolean
+write_index(const char *index_file, GPtrArray *entries, GError **error)
+{
+    g_ptr_array_sort(entries, compare_scan_entries);
+
+    StringTable table;
+    table.data = g_string_new("");
+    /* Offset 0 is the empty string */
+    g_string_append_c(table.data, '\0');
+    table.offsets = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+    GArray *records = g_array_sized_new(FALSE, TRUE, sizeof(EpubIndexRecord),
+                                        entries->len);
+    GArray *creator_keys = g_array_new(FALSE, FALSE, sizeof(EpubIndexKey));
+    GArray *lang_keys = g_array_new(FALSE, FALSE, sizeof(EpubIndexKey));
+    GArray *identifier_keys = g_array_new(FALSE, FALSE, sizeof(EpubIndexKey));
+    GByteArray *books = g_byte_array_new();
+    for(guint i = 0; i < entries->len; ++i) {
+        const ScanEntry *entry = g_ptr_array_index(entries, i);
+        EpubIndexRecord record;
+        memset(&record, 0, sizeof(record));
+        record.mtime = entry->mtime;
+        record.size = entry->size;
+        record.path = string_table_add(&table, entry->path);
+        record.book = books->len;
+        record.status = entry->status;
+        record.flags = entry->flags;
+        g_array_append_val(records, record);
+
+        /* Copied as is, padded so the next one is aligned */
+        const EpubRecord *book = entry->book;
+        static const guint8 padding[8];
+        g_byte_array_append(books, (const guint8 *)book, book->size);
+        g_byte_array_append(books, padding, (8 - book->size % 8) % 8);
+
+        add_list_keys(&table, creator_keys, (const char *)book + book->creators,
+                      book->n_creators, i);
+        add_list_keys(&table, identifier_keys,
+                      (const char *)book + book->identifiers,
+                      book->n_identifiers, i);
+        if(*epub_record_lang(book)) {
+            EpubIndexKey key = {string_table_add_key(&table, epub_record_lang(book)), i};
+            g_array_append_val(lang_keys, key);
+        }
+    }
+    g_array_sort_with_data(creator_keys, compare_keys, &table);
+    g_array_sort_with_data(lang_keys, compare_keys, &table);
+    g_array_sort_with_data(identifier_keys, compare_keys, &table);
+
+    EpubIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, EPUB_INDEX_MAGIC, sizeof(header.magic));
+    header.version = EPUB_INDEX_VERSION;
+    header.n_entries = records->len;
+    header.n_creator_keys = creator_keys->len;
+    header.n_lang_keys = lang_keys->len;
+    header.n_identifier_keys = identifier_keys->len;
+    header.strings_size = (guint32)table.data->len;
+    header.books_size = books->len;
+
+    GByteArray *blob = g_byte_array_new();
+    g_byte_array_append(blob, (const guint8 *)&header, sizeof(header));
+    g_byte_array_append(blob, (const guint8 *)records->data,
+                        records->len * sizeof(EpubIndexRecord));
+    g_byte_array_append(blob, (const guint8 *)creator_keys->data,
+                        creator_keys->len * sizeof(EpubIndexKey));
+    g_byte_array_append(blob, (const guint8 *)lang_keys->data,
+                        lang_keys->len * sizeof(EpubIndexKey));
+    g_byte_array_append(blob, (const guint8 *)identifier_keys->data,
+                        identifier_keys->len * sizeof(EpubIndexKey));
+    g_byte_array_append(blob, books->data, books->len);
+    g_byte_array_append(blob, (const guint8 *)table.data->str, table.data->len);
+
+    /* Atomic replace, readers never see a half written index */
+    gboolean ok = g_file_set_contents(index_file, (const char *)blob->data,
+                                      blob->len, error);
+    g_byte_array_unref(blob);
+    g_byte_array_unref(books);
+    g_array_unref(records);
+    g_array_unref(creator_keys);
+    g_array_unref(lang_keys);
+    g_array_unref(identifier_keys);
+    g_hash_table_destroy(table.offsets);
+    g_string_free(table.data, TRUE);
+    return ok;
+}
+
+/* Reading */
+
+EpubIndex *
+epub_index_open(const char *index_file, GError **error)
+{
+    GMappedFile *mapped = g_mapped_file_new(index_file, FALSE, error);
+    if(!mapped)
+        return NULL;
+    const char *data = g_mapped_file_get_contents(mapped);
+    const gsize len = g_mapped_file_get_length(mapped);
+    const EpubIndexHeader *header = (const EpubIndexHeader *)data;
+    if(len < sizeof(EpubIndexHeader)
+       || memcmp(header->magic, EPUB_INDEX_MAGIC, sizeof(header->magic)) != 0
+       || header->version != EPUB_INDEX_VERSION
+       || len != sizeof(EpubIndexHeader)
+                 + (gsize)header->n_entries * sizeof(EpubIndexRecord)
+                 + ((gsize)header->n_creator_keys + header->n_lang_keys
+                    + header->n_identifier_keys) * sizeof(EpubIndexKey)
+                 + header->books_size + header->strings_size
+       || header->strings_size == 0) {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                    "%s is not an epub index", index_file);
+        g_mapped_file_unref(mapped);
+        return NULL;
+    }
+    EpubIndex *index = g_new0(EpubIndex, 1);
+    index->mapped = mapped;
+    index->header = header;
+    index->records = (const EpubIndexRecord *)(header + 1);
+    index->creator_keys = (const EpubIndexKey *)(index->records + header->n_entries);
+    index->lang_keys = index->creator_keys + header->n_creator_keys;
+    index->identifier_keys = index->lang_keys + header->n_lang_keys;
+    index->books = (const char *)(index->identifier_keys
+                                  + header->n_identifier_keys);
+    index->strings = index->books + header->books_size;
+    if(index->strings[header->strings_size - 1] != '\0') {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                    "%s: corrupt string table", index_file);
+        epub_index_close(index);
+        return NULL;
+    }
+    /* Records are checked when they are used, see index_book(); opening
+       touches nothing but the header so that it is cheap enough for the
+       module to do on the main loop */
+    return index;
+}
+
+void
+epub_index_close(EpubIndex *index)
+{
+    if(!index)
+        return;
+    g_mapped_file_unref(index->mapped);
+    g_free(index);
+}
+
+guint
+epub_index_get_n_entries(const EpubIndex *index)
+{
+    return index->header->n_entries;
+}
+
+const EpubIndexRecord *
+epub_index_get_record(const EpubIndex *index, guint entry)
+{
+    g_return_val_if_fail(entry < index->header->n_entries, NULL);
+    return &index->records[entry];
+}
+
+const char *
+epub_index_get_string(const EpubIndex *index, guint32 offset)
+{
+    if(offset >= index->header->strings_size)
+        return "";
+    return index->strings + offset;
+}
+
+/* NULL if the record at record->book is damaged */
+static const EpubRecord *
+index_book(const EpubIndex *index, const EpubIndexRecord *record)
+{
+    const guint32 book = record->book;
+    if(book % 8 != 0 || book >= index->header->books_size
+       || !epub_record_validate(index->books + book,
+                                index->header->books_size - book))
+        return NULL;
+    return (const EpubRecord *)(index->books + book);
+}
+
+const EpubRecord *
+epub_index_get_book(const EpubIndex *index, const EpubIndexRecord *record)
+{
+    /* Header and two empty strings, title and lang */
+    static const struct {
+        EpubRecord header;
+        char strings[2];
+    } empty = {
+        { 0, 0, sizeof(EpubRecord) + 2, sizeof(EpubRecord),
+          sizeof(EpubRecord) + 1, sizeof(EpubRecord) + 2,
+          sizeof(EpubRecord) + 2, 0, 0, 0 },
+        ""
+    };
+    const EpubRecord *result = index_book(index, record);
+    return result ? result : &empty.header;
+}
+
+gboolean
+epub_index_book_is_valid(const EpubIndex *index, const EpubIndexRecord *record)
+{
+    return index_book(index, record) != NULL;
+}
+
+const EpubIndexRecord *
+epub_index_find(const EpubIndex *index, const char *path)
+{
+    guint lo = 0, hi = index->header->n_entries;
+    while(lo < hi) {
+        const guint mid = lo + (hi - lo) / 2;
+        const int cmp = strcmp(epub_index_get_string(index,
+                                                     index->records[mid].path),
+                               path);
+        if(cmp == 0)
+            return &index->records[mid];
+        if(cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return NULL;
+}
+
+static gint
+compare_guint(gconstpointer a, gconstpointer b)
+{
+    const guint lhs = *(const guint *)a;
+    const guint rhs = *(const guint *)b;
+    return lhs < rhs ? -1 : lhs > rhs;
+}
+
+static const EpubIndexKey *
+index_keys(const EpubIndex *index, EpubIndexKeyKind kind, guint *n_keys)
+{
+    switch(kind) {
+    case EPUB_INDEX_BY_CREATOR:
+        *n_keys = index->header->n_creator_keys;
+        return index->creator_keys;
+    case EPUB_INDEX_BY_LANG:
+        *n_keys = index->header->n_lang_keys;
+        return index->lang_keys;
+    case EPUB_INDEX_BY_IDENTIFIER:
+        *n_keys = index->header->n_identifier_keys;
+        return index->identifier_keys;
+    }
+    *n_keys = 0;
+    return NULL;
+}
+
+GArray *
+epub_index_lookup(const EpubIndex *index, EpubIndexKeyKind kind,
+                  const char *value, gboolean prefix)
+{
+    GArray *result = g_array_new(FALSE, FALSE, sizeof(guint));
+    guint n_keys;
+    const EpubIndexKey *keys = index_keys(index, kind, &n_keys);
+    char *folded = g_utf8_casefold(value, -1);
+    const size_t folded_len = strlen(folded);
+
+    /* Lower bound of folded */
+    guint lo = 0, hi = n_keys;
+    while(lo < hi) {
+        const guint mid = lo + (hi - lo) / 2;
+        if(strcmp(epub_index_get_string(index, keys[mid].key), folded) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    for(; lo < n_keys; ++lo) {
+        const char *key = epub_index_get_string(index, keys[lo].key);
+        if(prefix ? strncmp(key, folded, folded_len) != 0 : strcmp(key, folded) != 0)
+            break;
+        /* Keys come straight from the file, a damaged one is skipped */
+        if(keys[lo].entry < index->header->n_entries)
+            g_array_append_val(result, keys[lo].entry);
+    }
+    g_free(folded);
+    /* One book can match several keys with a prefix lookup */
+    g_array_sort(result, compare_guint);
+    guint n = 0;
+    for(guint i = 0; i < result->len; ++i) {
+        if(n == 0 || g_array_index(result, guint, n - 1) != g_array_index(result, guint, i))
+            g_array_index(result, guint, n++) = g_array_index(result, guint, i);
+    }
+    g_array_set_size(result, n);
+    return result;
+}
+
+/* Duplicates */
+
+static guint
+union_find(guint *parent, guint x)
+{
+    while(parent[x] != x) {
+        parent[x] = parent[parent[x]];
+        x = parent[x];
+    }
+    return x;
+}
+
+static void
+union_join(guint *parent, guint a, guint b)
+{
+    a = union_find(parent, a);
+    b = union_find(parent, b);
+    /* The smaller entry number becomes the root, groups come out sorted */
+    if(a < b)
+        parent[b] = a;
+    else if(b < a)
+        parent[a] = b;
+}
+
+/* Joins all entries whose 64 bit hash at offset in the EpubRecord is equal */
+static void
+join_by_hash(const EpubIndex *index, guint *parent, gsize offset)
+{
+    const guint n = index->header->n_entries;
+    GHashTable *first = g_hash_table_new(g_int64_hash, g_int64_equal);
+    for(guint i = 0; i < n; ++i) {
+        const EpubRecord *book = epub_index_get_book(index, &index->records[i]);
+        const guint64 *hash = (const guint64 *)((const char *)book + offset);
+        if(*hash == 0)
+            continue;
+        gpointer other;
+        if(g_hash_table_lookup_extended(first, hash, NULL, &other))
+            union_join(parent, GPOINTER_TO_UINT(other), i);
+        else
+            g_hash_table_insert(first, (gpointer)hash, GUINT_TO_POINTER(i));
+    }
+    g_hash_table_destroy(first);
+}
+
+GPtrArray *
+epub_index_find_duplicates(const EpubIndex *index, EpubDuplicateFlags flags)
+{
+    const guint n = index->header->n_entries;
+    guint *parent = g_new(guint, n);
+    for(guint i = 0; i < n; ++i)
+        parent[i] = i;
+
+    if(flags & EPUB_DUP_IDENTIFIER) {
+        /* Keys are sorted, equal identifiers are neighbours */
+        const EpubIndexKey *keys = index->identifier_keys;
+        for(guint i = 1; i < index->header->n_identifier_keys; ++i) {
+            /* Entries come straight from the file */
+            if(keys[i].key == keys[i - 1].key
+               && keys[i - 1].entry < n && keys[i].entry < n)
+                union_join(parent, keys[i - 1].entry, keys[i].entry);
+        }
+    }
+    if(flags & EPUB_DUP_CONTENT)
+        join_by_hash(index, parent, G_STRUCT_OFFSET(EpubRecord, content_hash));
+    if(flags & EPUB_DUP_METADATA)
+        join_by_hash(index, parent, G_STRUCT_OFFSET(EpubRecord, metadata_hash));
+
+    /* Entries are visited in order, so every group is sorted and groups
+       are ordered by their first entry */
+    GPtrArray *groups = g_ptr_array_new_with_free_func((GDestroyNotify)g_array_unref);
+    guint *group_of_root = g_new(guint, n);
+    for(guint i = 0; i < n; ++i) {
+        const guint root = union_find(parent, i);
+        if(root == i) {
+            group_of_root[i] = G_MAXUINT;
+            continue;
+        }
+        if(group_of_root[root] == G_MAXUINT) {
+            group_of_root[root] = groups->len;
+            GArray *group = g_array_new(FALSE, FALSE, sizeof(guint));
+            g_array_append_val(group, root);
+            g_ptr_array_add(groups, group);
+        }
+        g_array_append_val((GArray *)g_ptr_array_index(groups, group_of_root[root]), i);
+    }
+    g_free(group_of_root);
+    g_free(parent);
+    return groups;
+}
@@ -0,0 +1,129 @@
+#ifndef _EPUB_INDEX_
+#define _EPUB_INDEX_
+
+#include <glib.h>
+
+#include "epub-record.h"
+
+/* On-disk library index.
+
+   The file is written once by epub_index_update() and then used
+   read-only through a mapping, so a query never parses anything and
+   epub_index_open() only checks the header:
+
+     EpubIndexHeader
+     EpubIndexRecord  records[n_entries]      sorted by path
+     EpubIndexKey     creator_keys[n_creator_keys]
+     EpubIndexKey     lang_keys[n_lang_keys]
+     EpubIndexKey     identifier_keys[n_identifier_keys]
+     EpubRecord       books[]                 books_size bytes, 8 byte aligned
+     char             strings[strings_size]   NUL terminated, deduplicated
+
+   Paths and keys are byte offsets into the string table; offset 0 is
+   always the empty string. The metadata of each book is the EpubRecord
+   the reader returned, stored as is. Keys are sorted by their (casefolded) string
+   so lookups are a binary search. Integers are stored in host byte order;
+   an index is a local cache, not an interchange format. */
+
+#define EPUB_INDEX_MAGIC "EPIX"
+#define EPUB_INDEX_VERSION 4
+
+typedef struct {
+    char magic[4];
+    guint32 version;
+    guint32 n_entries;
+    guint32 n_creator_keys;
+    guint32 n_lang_keys;
+    guint32 n_identifier_keys;
+    guint32 strings_size;
+    guint32 books_size;
+} EpubIndexHeader;
+
+typedef struct {
+    gint64 mtime;     /* seconds, used with size to skip unchanged files */
+    gint64 size;
+    guint32 path;
+    guint32 book;     /* offset of the EpubRecord in books */
+    gint32 status;    /* read_book() result, EPUB_OK on success */
+    guint32 flags;    /* EpubIndexRecordFlags */
+} EpubIndexRecord;
+
+typedef enum {
+    /* Every member's CRC was checked, status is EPUB_ERR_CORRUPT if one
+       did not match */
+    EPUB_INDEX_RECORD_VERIFIED = 1 << 0
+} EpubIndexRecordFlags;
+
+typedef enum {
+    EPUB_INDEX_VERIFY = 1 << 0  /* also check archives, see epub-verify.h */
+} EpubIndexFlags;
+
+typedef struct {
+    guint32 key;      /* casefolded value */
+    guint32 entry;    /* index into records */
+} EpubIndexKey;
+
+typedef enum {
+    EPUB_INDEX_BY_CREATOR,
+    EPUB_INDEX_BY_LANG,
+    EPUB_INDEX_BY_IDENTIFIER
+} EpubIndexKeyKind;
+
+/* What makes two books duplicates, for epub_index_find_duplicates() */
+typedef enum {
+    EPUB_DUP_IDENTIFIER = 1 << 0, /* share a dc:identifier */
+    EPUB_DUP_CONTENT    = 1 << 1, /* same central directory CRC32 table */
+    EPUB_DUP_METADATA   = 1 << 2  /* same OPF metadata block */
+} EpubDuplicateFlags;
+
+typedef struct {
+    guint n_files;    /* book files found under the root */
+    guint n_parsed;   /* new or changed, read again */
+    guint n_reused;   /* unchanged since the previous index */
+    guint n_failed;   /* read_book() returned an error */
+    guint n_verified; /* archives checked in this run */
+    guint n_corrupt;  /* of those, with a bad member */
+} EpubIndexStats;
+
+typedef struct _EpubIndex EpubIndex;
+
+/* Scan root recursively and (re)write index_file. Entries of an existing
+   index whose mtime and size still match are reused without opening the
+   archive; that includes failures, so a broken book is not read again
+   until it changes. With EPUB_INDEX_VERIFY every archive that has not
+   been verified yet is checked once. n_threads == 0 means one worker
+   per CPU. Fails, leaving index_file alone, if root can't be opened. */
+gboolean epub_index_update(const char *root, const char *index_file,
+                           guint n_threads, EpubIndexFlags flags,
+                           EpubIndexStats *stats, GError **error);
+
+EpubIndex *epub_index_open(const char *index_file, GError **error);
+void epub_index_close(EpubIndex *index);
+
+guint epub_index_get_n_entries(const EpubIndex *index);
+const EpubIndexRecord *epub_index_get_record(const EpubIndex *index, guint entry);
+const char *epub_index_get_string(const EpubIndex *index, guint32 offset);
+/* Metadata of record; for failed books only the fingerprints. A damaged
+   record reads as an empty book, epub_index_update() reads it again. */
+const EpubRecord *epub_index_get_book(const EpubIndex *index,
+                                      const EpubIndexRecord *record);
+/* FALSE if the metadata of record is damaged */
+gboolean epub_index_book_is_valid(const EpubIndex *index,
+                                  const EpubIndexRecord *record);
+/* The entry for path, spelled as it was found under the root, or NULL */
+const EpubIndexRecord *epub_index_find(const EpubIndex *index,
+                                       const char *path);
+
+/* Entries whose key equals value, or starts with it when prefix is set.
+   Comparison is case-insensitive. Returns a sorted GArray of valid guint
+   entry numbers, free it with g_array_unref(). */
+GArray *epub_index_lookup(const EpubIndex *index, EpubIndexKeyKind kind,
+                          const char *value, gboolean prefix);
+
+/* Groups of two or more entries that are linked by any of the criteria in
+   flags, transitively. Runs in time linear in the number of entries and
+   keys. Returns a GPtrArray of sorted GArrays of guint entry numbers. */
+GPtrArray *epub_index_find_duplicates(const EpubIndex *index,
+                                      EpubDuplicateFlags flags);
+
+#endif /* _EPUB_INDEX_ */
@@ -0,0 +1,929 @@
+#include <errno.h>
+
+#include <libxml/parser.h>
+
+#include <zip.h>
+#include <string.h>
+#ifdef DEBUG
+#include <stdio.h>
+#endif
+#include <glib.h>
+
+#include "epub-reader.h"
+#include "epub-stats.h"
+
+/* Parse state, turned into an EpubRecord when the reader is done */
+typedef struct {
+    GString *text;           /* of the element being read */
+    char *title;             /* first one wins */
+    char *lang;
+    GPtrArray *creators;
+    GPtrArray *identifiers;
+    guint64 metadata_hash;
+    guint64 content_hash;
+    gboolean in_metadata;
+    gboolean hash_in_text;   /* non-blank text since the last tag */
+    gboolean hash_space;     /* whitespace after it, not hashed yet */
+    enum FSM_State my_state;
+} EpubInfo;
+
+/* FictionBook parse state */
+typedef struct {
+    EpubInfo *info;
+    GString *author;         /* first, middle and last name so far */
+    gboolean in_title_info;
+    gboolean in_author;
+    gboolean in_document_info;
+} Fb2Parser;
+
+typedef int (*ZipReader)(struct zip *za, EpubInfo *info);
+typedef int (*StreamReader)(GInputStream *stream, goffset size,
+                            GCancellable *cancellable, EpubRecord **record,
+                            EpubIoStats *io);
+
+static int read_from_zip(struct zip *za, EpubInfo *info);
+static int read_fb2_from_zip(struct zip *za, EpubInfo *info);
+static void reader_init(void);
+static void info_init(EpubInfo *info);
+static int info_finish(EpubInfo *info, int result, EpubRecord **record);
+static void info_commit_text(EpubInfo *info);
+static void metadata_hash_tag(EpubInfo *info, const char *tag,
+                              const char *name);
+static void metadata_hash_text(EpubInfo *info, const xmlChar *ch, int len);
+static guint64 archive_content_hash(struct zip *za);
+static int parse_zip_entry(struct zip *za, const char *name,
+                           xmlSAXHandler *SAXHander, enum FSM_State *state);
+static void make_sax_handler_container(xmlSAXHandler *SAXHander, void *user_data);
+static void make_sax_handler_contentOPF(xmlSAXHandler *SAXHander, void *user_data);
+static void make_sax_handler_fb2(xmlSAXHandler *SAXHander, void *user_data);
+static int parse_input_stream(GInputStream *stream, GCancellable *cancellable,
+                              xmlSAXHandler *SAXHander,
+                              enum FSM_State *state, EpubIoStats *io);
+static void OnStartElementFb2Ns(
+    void *ctx,
+    const xmlChar *localname,
+    const xmlChar *prefix,
+    const xmlChar *URI,
+    int nb_namespaces,
+    const xmlChar **namespaces,
+    int nb_attributes,
+    int nb_defaulted,
+    const xmlChar **attributes
+    );
+static void OnEndElementFb2Ns(
+    void* ctx,
+    const xmlChar* localname,
+    const xmlChar* prefix,
+    const xmlChar* URI
+    );
+static void OnCharactersFb2(void *ctx, const xmlChar *ch, int len);
+static void OnStartElementNs(
+    void *ctx,
+    const xmlChar *localname,
+    const xmlChar *prefix,
+    const xmlChar *URI,
+    int nb_namespaces,
+    const xmlChar **namespaces,
+    int nb_attributes,
+    int nb_defaulted,
+    const xmlChar **attributes
+    );
+static void OnStartElementContainerNs(
+    void *ctx,
+    const xmlChar *localname,
+    const xmlChar *prefix,
+    const xmlChar *URI,
+    int nb_namespaces,
+    const xmlChar **namespaces,
+    int nb_attributes,
+    int nb_defaulted,
+    const xmlChar **attributes
+    );
+
+static void OnEndElementNs(
+    void* ctx,
+    const xmlChar* localname,
+    const xmlChar* prefix,
+    const xmlChar* URI
+    );
+
+static void OnCharacters(void *ctx, const xmlChar *ch, int len);
+
+static void my_strlcpy(char *dest, const char *src_begin, const char *src_end, size_t count);
+static void append_text(GString *text, const xmlChar *ch, int len);
+static int my_strncmp(const char *lhs, const char *rhs_begin, const char *rhs_end, size_t count);
+
+static const char *epub_errors[] = {"ok", "ZIP read error", "ZIP inner file open error",
+                                    "Epub container.xml file parse XML error",
+                                    "Epub OPF file parse XML error",
+                                    "can't close zip archive",
+                                    "unknown book format",
+                                    "FB2 description parse XML error",
+                                    "archive member CRC mismatch or truncated"};
+
+const char *
+epub_strerror(int code)
+{
+    if(code < 0 || code >= (int)G_N_ELEMENTS(epub_errors))
+        return "unknown error";
+    return epub_errors[code];
+}
+
+/* Epub */
+
+static gsize parser_initialized;
+
+/* Sets up libxml2 when the first XML member is parsed, a process that
+   never meets a book never pays for it */
+static void
+reader_init(void)
+{
+    if(g_once_init_enter(&parser_initialized)) {
+        const gint64 start = epub_stats_now();
+        xmlInitParser();
+        LIBXML_TEST_VERSION
+        epub_stats_record_since(EPUB_STAT_FIRST_USE, start);
+        g_once_init_leave(&parser_initialized, 1);
+    }
+}
+
+void
+epub_reader_cleanup(void)
+{
+    if(parser_initialized)
+        xmlCleanupParser();
+}
+
+static void
+info_init(EpubInfo *info)
+{
+    memset(info, 0, sizeof(EpubInfo));
+    info->text = g_string_new("");
+    info->creators = g_ptr_array_new_with_free_func(g_free);
+    info->identifiers = g_ptr_array_new_with_free_func(g_free);
+}
+
+/* Packs what was found into *record, frees the parse state */
+static int
+info_finish(EpubInfo *info, int result, EpubRecord **record)
+{
+    *record = epub_record_new(info->title, info->lang,
+                              (const char *const *)info->creators->pdata,
+                              info->creators->len,
+                              (const char *const *)info->identifiers->pdata,
+                              info->identifiers->len,
+                              info->metadata_hash, info->content_hash);
+    g_string_free(info->text, TRUE);
+    g_free(info->title);
+    g_free(info->lang);
+    g_ptr_array_unref(info->creators);
+    g_ptr_array_unref(info->identifiers);
+    epub_stats_add(EPUB_STAT_BOOKS, 1);
+    if(result != EPUB_OK)
+        epub_stats_add(EPUB_STAT_ERRORS, 1);
+    return result;
+}
+
+/* Opens the archive and hands it to reader, which closes it */
+static int
+read_zip_path(const char *archive, EpubRecord **record, ZipReader reader)
+{
+    /* Zip error */
+    int err = 0;
+    char errbuf[MAX_STR_LEN];
+    /* Zip */
+    struct zip *za;
+    EpubInfo info;
+    info_init(&info);
+    const gint64 start = epub_stats_now();
+    za = zip_open(archive, 0, &err);
+    epub_stats_record_since(EPUB_STAT_ZIP_OPEN, start);
+    if (za == NULL) {
+        zip_error_to_str(errbuf, sizeof(errbuf), err, errno);
+        info.title = g_strdup(errbuf);
+        return info_finish(&info, EPUB_ERR_ZIP_OPEN, record);
+    }
+    return info_finish(&info, reader(za, &info), record);
+}
+
+static int
+read_zip_stream(GInputStream *stream, goffset size, GCancellable *cancellable,
+                EpubRecord **record, EpubIoStats *io, ZipReader reader)
+{
+    struct zip *za = NULL;
+    zip_error_t error;
+    EpubInfo info;
+    info_init(&info);
+    zip_error_init(&error);
+    const gint64 start = epub_stats_now();
+    zip_source_t *src = epub_zip_source_new(stream, size, cancellable, io,
+                                            &error);
+    if(src) {
+        za = zip_open_from_source(src, ZIP_RDONLY, &error);
+        if(!za)
+            zip_source_free(src);
+    }
+    epub_stats_record_since(EPUB_STAT_ZIP_OPEN, start);
+    if(za == NULL) {
+        info.title = g_strdup(zip_error_strerror(&error));
+        zip_error_fini(&error);
+        return info_finish(&info, EPUB_ERR_ZIP_OPEN, record);
+    }
+    zip_error_fini(&error);
+    return info_finish(&info, reader(za, &info), record);
+}
+
+static int
+read_file_with(GFile *file, GCancellable *cancellable, EpubRecord **record,
+               EpubIoStats *io, StreamReader reader)
+{
+    GError *error = NULL;
+    goffset size = 0;
+    GInputStream *stream = epub_file_read(file, cancellable, &size, &error);
+    if(!stream) {
+        EpubInfo info;
+        info_init(&info);
+        info.title = g_strdup(error->message);
+        g_error_free(error);
+        return info_finish(&info, EPUB_ERR_ZIP_OPEN, record);
+    }
+    const int result = reader(stream, size, cancellable, record, io);
+    g_object_unref(stream);
+    return result;
+}
+
+int
+read_from_epub(const char *archive, EpubRecord **record)
+{
+    return read_zip_path(archive, record, read_from_zip);
+}
+
+int
+read_from_epub_stream(GInputStream *stream, goffset size,
+                      GCancellable *cancellable, EpubRecord **record,
+                      EpubIoStats *io)
+{
+    return read_zip_stream(stream, size, cancellable, record, io,
+                           read_from_zip);
+}
+
+int
+read_from_epub_file(GFile *file, GCancellable *cancellable,
+                    EpubRecord **record, EpubIoStats *io)
+{
+    return read_file_with(file, cancellable, record, io, read_from_epub_stream);
+}
+
+/* FB2 */
+
+int
+read_from_fb2_zip(const char *archive, EpubRecord **record)
+{
+    return read_zip_path(archive, record, read_fb2_from_zip);
+}
+
+int
+read_from_fb2_zip_stream(GInputStream *stream, goffset size,
+                         GCancellable *cancellable, EpubRecord **record,
+                         EpubIoStats *io)
+{
+    return read_zip_stream(stream, size, cancellable, record, io,
+                           read_fb2_from_zip);
+}
+
+int
+read_from_fb2(const char *path, EpubRecord **record)
+{
+    GFile *file = g_file_new_for_path(path);
+    const int result = read_file_with(file, NULL, record, NULL, read_from_fb2_stream);
+    g_object_unref(file);
+    return result;
+}
+
+int
+read_from_fb2_stream(GInputStream *stream, goffset size,
+                     GCancellable *cancellable, EpubRecord **record,
+                     EpubIoStats *io)
+{
+    Fb2Parser parser;
+    xmlSAXHandler SAXHander;
+    EpubInfo info;
+    info_init(&info);
+    memset(&parser, 0, sizeof(Fb2Parser));
+    parser.info = &info;
+    parser.author = g_string_new("");
+    make_sax_handler_fb2(&SAXHander, &parser);
+    const gint64 start = epub_stats_now();
+    int result = parse_input_stream(stream, cancellable, &SAXHander,
+                                    &info.my_state, io);
+    epub_stats_record_since(EPUB_STAT_OPF_PARSE, start);
+    if(result == EPUB_OK && info.my_state != STOP)
+        result = EPUB_ERR_FB2;
+    g_string_free(parser.author, TRUE);
+    return info_finish(&info, result, record);
+}
+
+/* The first *.fb2 member; no container.xml to tell us */
+static int
+read_fb2_from_zip(struct zip *za, EpubInfo *info)
+{
+    info->content_hash = archive_content_hash(za);
+    const zip_int64_t num64 = zip_get_num_entries(za, 0);
+    const char *name = NULL;
+    for(zip_int64_t i = 0; i < num64 && !name; ++i) {
+        const char *entry = zip_get_name(za, (zip_uint64_t)i, 0);
+        if(entry && g_str_has_suffix(entry, ".fb2"))
+            name = entry;
+    }
+    if(!name) {
+        zip_close(za);
+        return EPUB_ERR_ZIP_FOPEN;
+    }
+    Fb2Parser parser;
+    xmlSAXHandler SAXHander;
+    memset(&parser, 0, sizeof(Fb2Parser));
+    parser.info = info;
+    parser.author = g_string_new("");
+    make_sax_handler_fb2(&SAXHander, &parser);
+    const gint64 start = epub_stats_now();
+    int result = parse_zip_entry(za, name, &SAXHander, &info->my_state);
+    epub_stats_record_since(EPUB_STAT_OPF_PARSE, start);
+    g_string_free(parser.author, TRUE);
+    if(result == EPUB_OK && info->my_state != STOP)
+        result = EPUB_ERR_FB2;
+    if(result != EPUB_OK) {
+        zip_close(za);
+        return result == EPUB_ERR_ZIP_FOPEN ? result : EPUB_ERR_FB2;
+    }
+    if (zip_close(za) == -1) {
+        zip_discard(za);
+        return EPUB_ERR_ZIP_CLOSE;
+    }
+    return EPUB_OK;
+}
+
+/* Everything after the archive is open; closes za */
+static int
+read_from_zip(struct zip *za, EpubInfo *info)
+{
+    info->content_hash = archive_content_hash(za);
+    /*Read container.xml*/
+    AboutContainer container;
+    memset(&container, 0, sizeof(AboutContainer));
+    container.my_state = INIT;
+    xmlSAXHandler SAXHander;
+    make_sax_handler_container(&SAXHander, &container);
+    gint64 start = epub_stats_now();
+    int result = parse_zip_entry(za, "META-INF/container.xml",
+                                 &SAXHander, &container.my_state);
+    start = epub_stats_record_since(EPUB_STAT_CONTAINER_PARSE, start);
+    if(result != EPUB_OK || container.contentFilename[0] == '\0') {
+        zip_close(za);
+        return result == EPUB_ERR_ZIP_FOPEN ? result : EPUB_ERR_CONTAINER;
+    }
+    /* Read book info */
+    make_sax_handler_contentOPF(&SAXHander, info);
+    info->my_state = INIT;
+    result = parse_zip_entry(za, container.contentFilename,
+                             &SAXHander, &info->my_state);
+    epub_stats_record_since(EPUB_STAT_OPF_PARSE, start);
+    if(result != EPUB_OK) {
+        zip_close(za);
+        return result == EPUB_ERR_ZIP_FOPEN ? EPUB_ERR_CONTAINER : EPUB_ERR_OPF;
+    }
+    /* End */
+    if (zip_close(za) == -1) {
+        zip_discard(za);
+        return EPUB_ERR_ZIP_CLOSE;
+    }
+    return EPUB_OK;
+}
+
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+static inline guint64
+fnv1a_update(guint64 hash, const void *data, size_t len)
+{
+    const unsigned char *p = data;
+    for(size_t i = 0; i < len; ++i) {
+        hash ^= p[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+/* The metadata fingerprint covers element names and the text inside them.
+   Leading and trailing whitespace of each text is dropped and inner runs
+   count as one space, so the same metadata indented or wrapped
+   differently hashes the same. */
+static void
+metadata_hash_tag(EpubInfo *info, const char *tag, const char *name)
+{
+    info->metadata_hash = fnv1a_update(info->metadata_hash, tag, 1);
+    if(name)
+        info->metadata_hash = fnv1a_update(info->metadata_hash, name,
+                                           strlen(name));
+    info->hash_in_text = FALSE;
+    info->hash_space = FALSE;
+}
+
+static void
+metadata_hash_text(EpubInfo *info, const xmlChar *ch, int len)
+{
+    guint64 hash = info->metadata_hash;
+    for(int i = 0; i < len; ++i) {
+        if(ch[i] == ' ' || ch[i] == '\t' || ch[i] == '\n' || ch[i] == '\r') {
+            info->hash_space = info->hash_in_text;
+            continue;
+        }
+        if(!info->hash_in_text) {
+            hash = fnv1a_update(hash, "=", 1);
+            info->hash_in_text = TRUE;
+        } else if(info->hash_space) {
+            hash = fnv1a_update(hash, " ", 1);
+        }
+        info->hash_space = FALSE;
+        hash = fnv1a_update(hash, &ch[i], 1);
+    }
+    info->metadata_hash = hash;
+}
+
+/* splitmix64 finalizer */
+static inline guint64
+mix64(guint64 x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+/* Fingerprint of the archive payload taken from the central directory
+   libzip already read on open: no member is decompressed. Entries are
+   combined with a sum so the order inside the archive does not matter. */
+static guint64
+archive_content_hash(struct zip *za)
+{
+    const zip_int64_t num64 = zip_get_num_entries(za, 0);
+    guint64 hash = mix64((guint64)num64);
+    for(zip_int64_t i = 0; i < num64; ++i) {
+        struct zip_stat sb;
+        zip_stat_init(&sb);
+        if(zip_stat_index(za, (zip_uint64_t)i, 0, &sb) != 0
+           || !(sb.valid & ZIP_STAT_CRC) || !(sb.valid & ZIP_STAT_SIZE))
+            return 0;
+        hash += mix64(mix64(sb.size) ^ sb.crc);
+    }
+    return hash ? hash : 1;
+}
+
+/* Push one archive member through a SAX handler until the handler
+   reports STOP or the member ends. Returns EPUB_ERR_ZIP_FOPEN when the
+   member is missing and EPUB_ERR_OPF on XML errors. */
+static int
+parse_zip_entry(struct zip *za, const char *name,
+                xmlSAXHandler *SAXHander, enum FSM_State *state)
+{
+    char buffer[ZIP_BUFFER_LEN];
+    zip_int64_t fread_len; /* Really read bytes from zipped file. */
+    int result = EPUB_OK;
+    struct zip_file *zf = zip_fopen(za, name, 0);
+    if(!zf)
+        return EPUB_ERR_ZIP_FOPEN;
+    fread_len = zip_fread(zf, buffer, sizeof(buffer));
+    if(fread_len <= 0) {
+        zip_fclose(zf);
+        return EPUB_ERR_OPF;
+    }
+    guint64 inflated = fread_len;
+    reader_init();
+    xmlParserCtxtPtr ctxt = xmlCreatePushParserCtxt(
+        SAXHander, NULL, buffer, (int)fread_len, name
+    );
+    if(!ctxt) {
+        zip_fclose(zf);
+        return EPUB_ERR_OPF;
+    }
+    while(*state != STOP) {
+        fread_len = zip_fread(zf, buffer, sizeof(buffer));
+        const int terminate = fread_len <= 0;
+        if(!terminate)
+            inflated += fread_len;
+        if(xmlParseChunk(ctxt, buffer, terminate ? 0 : (int)fread_len, terminate)
+           && *state != STOP) {
+            #ifdef DEBUG
+            xmlParserError(ctxt, "xmlParseChunk");
+            #endif
+            result = EPUB_ERR_OPF;
+            break;
+        }
+        if(terminate)
+            break;
+    }
+    xmlFreeParserCtxt(ctxt);
+    zip_fclose(zf);
+    epub_stats_add(EPUB_STAT_BYTES_INFLATED, inflated);
+    return result;
+}
+
+static void
+make_sax_handler_container(xmlSAXHandler *SAXHander,
+                           void *user_data)
+{
+    memset(SAXHander, 0, sizeof(xmlSAXHandler));
+    SAXHander->initialized = XML_SAX2_MAGIC;
+    SAXHander->startElementNs = OnStartElementContainerNs;
+    SAXHander->_private = user_data;
+}
+
+static void
+make_sax_handler_contentOPF(xmlSAXHandler *SAXHander,
+                            void *user_data)
+{
+    memset(SAXHander, 0, sizeof(xmlSAXHandler));
+    SAXHander->initialized = XML_SAX2_MAGIC;
+    SAXHander->startElementNs = OnStartElementNs;
+    SAXHander->endElementNs = OnEndElementNs;
+    SAXHander->characters = OnCharacters;
+    SAXHander->_private = user_data;
+}
+
+static void
+make_sax_handler_fb2(xmlSAXHandler *SAXHander,
+                     void *user_data)
+{
+    memset(SAXHander, 0, sizeof(xmlSAXHandler));
+    SAXHander->initialized = XML_SAX2_MAGIC;
+    SAXHander->startElementNs = OnStartElementFb2Ns;
+    SAXHander->endElementNs = OnEndElementFb2Ns;
+    SAXHander->characters = OnCharactersFb2;
+    SAXHander->_private = user_data;
+}
+
+/* Like parse_zip_entry() for a plain stream, e.g. an uncompressed FB2.
+   Reads are EPUB_STREAM_WINDOW sized like the zip source's, on a remote
+   location each one is a round trip. Returns EPUB_ERR_FB2 on read and
+   XML errors. */
+static int
+parse_input_stream(GInputStream *stream, GCancellable *cancellable,
+                   xmlSAXHandler *SAXHander, enum FSM_State *state,
+                   EpubIoStats *io)
+{
+    int result = EPUB_OK;
+    reader_init();
+    xmlParserCtxtPtr ctxt = xmlCreatePushParserCtxt(SAXHander, NULL, NULL, 0, NULL);
+    if(!ctxt)
+        return EPUB_ERR_FB2;
+    char *buffer = g_malloc(EPUB_STREAM_WINDOW);
+    guint64 read_bytes = 0;
+    while(*state != STOP) {
+        const gssize n = g_input_stream_read(stream, buffer, EPUB_STREAM_WINDOW,
+                                             cancellable, NULL);
+        if(io)
+            ++io->round_trips;
+        if(n < 0) {
+            result = EPUB_ERR_FB2;
+            break;
+        }
+        read_bytes += n;
+        const int terminate = n == 0;
+        if(xmlParseChunk(ctxt, buffer, (int)n, terminate) && *state != STOP) {
+            #ifdef DEBUG
+            xmlParserError(ctxt, "xmlParseChunk");
+            #endif
+            result = EPUB_ERR_FB2;
+            break;
+        }
+        if(terminate)
+            break;
+    }
+    xmlFreeParserCtxt(ctxt);
+    g_free(buffer);
+    if(io)
+        io->bytes_read += read_bytes;
+    epub_stats_add(EPUB_STAT_BYTES_INFLATED, read_bytes);
+    return result;
+}
+
+static void
+my_strlcpy(char *dest, const char *src_begin, const char *src_end, size_t count)
+{
+    size_t i = 0;
+    //for(char *a=(char *)src_begin; a < src_end && i < count; ++a, ++i)
+    //dest[i] = *a;
+    for(; src_begin < src_end && i + 1 < count; ++src_begin, ++i, ++dest)
+        *dest = *src_begin;
+    *dest = '\0';
+}
+
+static int
+my_strncmp(const char *lhs, const char *rhs_begin, const char *rhs_end, size_t count)
+{
+    /*See: http://cmcmsu.no-ip.info/2course/strcmp.feature.htm */
+    for(size_t i = 0; rhs_begin != rhs_end && i < count; ++i, ++lhs, ++rhs_begin) {
+        if((unsigned char)*lhs != (unsigned char)*rhs_begin)
+            return -1;
+    }
+    return 0;
+}
+
+static void
+OnStartElementContainerNs(
+    void *ctx,
+    const xmlChar *localname,
+    const xmlChar *prefix,
+    const xmlChar *URI,
+    int nb_namespaces,
+    const xmlChar **namespaces,
+    int nb_attributes,
+    int nb_defaulted,
+    const xmlChar **attributes
+    )
+{
+    #ifdef DEBUG
+    fprintf (stderr, "Event: OnStartElementContainerNs!\n");
+    #endif
+    xmlSAXHandlerPtr handler = ((xmlParserCtxtPtr)ctx)->sax;
+    AboutContainer *container = (AboutContainer *)(handler->_private);
+    if(g_strcmp0((const char*)localname, "rootfile") == 0) {
+        size_t index = 0;
+        for(int indexAttr = 0;
+            indexAttr < nb_attributes;
+            ++indexAttr, index += 5) {
+            const xmlChar *a_localname = attributes[index];
+            const xmlChar *a_valueBegin = attributes[index+3];
+            const xmlChar *a_valueEnd = attributes[index+4];
+            if(g_strcmp0((const char*)a_localname, "full-path") == 0) {
+                my_strlcpy(container->contentFilename, (const char *)a_valueBegin, (const char *)a_valueEnd, MAX_STR_LEN);
+            }
+            if( g_strcmp0((const char*)a_localname, "media-type") == 0 &&
+                my_strncmp("application/oebps-package+xml", (const char *)a_valueBegin, (const char *)a_valueEnd, MAX_STR_LEN) == 0
+                ) {
+                container->my_state = STOP;
+            }
+        }
+    }
+}
+
+/* Appends len bytes of ch; a text node can arrive in several
+   characters() calls. Anything past EPUB_RECORD_MAX_TEXT is dropped
+   here already, the record would cut it anyway. */
+static void
+append_text(GString *text, const xmlChar *ch, int len)
+{
+    if(text->len + len >= EPUB_RECORD_MAX_TEXT)
+        len = text->len < EPUB_RECORD_MAX_TEXT ? EPUB_RECORD_MAX_TEXT - text->len : 0;
+    g_string_append_len(text, (const char *)ch, len);
+}
+
+/* The element whose text was collected has ended */
+static void
+info_commit_text(EpubInfo *info)
+{
+    g_strstrip(info->text->str);
+    const char *text = info->text->str;
+    switch (info->my_state) {
+    case BOOK_TITLE_OPENED:
+        if (!info->title)
+            info->title = g_strdup(text);
+        info->my_state = BOOK_TITLE_END;
+        break;
+    case LANG_OPENED:
+        if (!info->lang)
+            info->lang = g_strdup(text);
+        info->my_state = LANG_END;
+        break;
+    case CREATOR_OPENED:
+        if (*text)
+            g_ptr_array_add(info->creators, g_strdup(text));
+        info->my_state = CREATOR_END;
+        break;
+    case IDENTIFIER_OPENED:
+        if (*text)
+            g_ptr_array_add(info->identifiers, g_strdup(text));
+        info->my_state = IDENTIFIER_END;
+        break;
+    default:
+        break;
+    }
+    g_string_truncate(info->text, 0);
+}
+
+static void
+OnCharacters(void * ctx,
+    const xmlChar * ch,
+    int len)
+{
+    #ifdef DEBUG
+    fprintf(stderr, "Event: OnCharacters!\n");
+    #endif
+    xmlSAXHandlerPtr handler = ((xmlParserCtxtPtr)ctx)->sax;
+    EpubInfo *info = (EpubInfo *)(handler->_private);
+    if(info->in_metadata)
+        metadata_hash_text(info, ch, len);
+    switch (info->my_state) {
+    case BOOK_TITLE_OPENED:
+    case CREATOR_OPENED:
+    case LANG_OPENED:
+    case IDENTIFIER_OPENED:
+        append_text(info->text, ch, len);
+        break;
+    default:
+        break;
+    }
+}
+
+static void
+OnStartElementNs(
+    void *ctx,
+    const xmlChar *localname,
+    const xmlChar *prefix,
+    const xmlChar *URI,
+    int nb_namespaces,
+    const xmlChar **namespaces,
+    int nb_attributes,
+    int nb_defaulted,
+    const xmlChar **attributes
+    )
+{
+    #ifdef DEBUG
+    fprintf (stderr, "Event: OnStartElementNs!\n");
+    #endif
+    xmlSAXHandlerPtr handler = ((xmlParserCtxtPtr)ctx)->sax;
+    EpubInfo *info = (EpubInfo *)(handler->_private);
+    info->my_state = INIT;
+    g_string_truncate(info->text, 0);
+    if (g_strcmp0((const char*)localname, "metadata") == 0) {
+        info->in_metadata = TRUE;
+        info->metadata_hash = FNV_OFFSET_BASIS;
+    }
+    if (info->in_metadata) {
+        /* Element names keep "<a>x</a><b/>" apart from "<a/><b>x</b>" */
+        metadata_hash_tag(info, "<", (const char *)localname);
+    }
+    if (g_strcmp0((const char*)localname, "creator") == 0) {
+        info->my_state = CREATOR_OPENED;
+        return;
+    }
+    if (g_strcmp0((const char*)localname, "language") == 0) {
+        info->my_state = LANG_OPENED;
+        return;
+    }
+    if (g_strcmp0((const char*)localname, "title") == 0) {
+        info->my_state = BOOK_TITLE_OPENED;
+        return;
+    }
+    if (g_strcmp0((const char*)localname, "identifier") == 0) {
+        info->my_state = IDENTIFIER_OPENED;
+        return;
+    }
+}
+
+static void
+OnEndElementNs(
+    void* ctx,
+    const xmlChar* localname,
+    const xmlChar* prefix,
+    const xmlChar* URI
+    )
+{
+    #ifdef DEBUG
+    fprintf (stderr, "Event: OnEndElementNs!\n");
+    #endif
+    xmlSAXHandlerPtr handler = ((xmlParserCtxtPtr)ctx)->sax;
+    EpubInfo *info = (EpubInfo *)(handler->_private);
+    if (info->in_metadata)
+        metadata_hash_tag(info, ">", NULL);
+    info_commit_text(info);
+    if (g_strcmp0((const char*)localname, "metadata") == 0) {
+        info->in_metadata = FALSE;
+        info->my_state = STOP;
+        xmlStopParser(ctx);
+    }
+}
+
+/* FB2 */
+
+static void
+OnStartElementFb2Ns(
+    void *ctx,
+    const xmlChar *localname,
+    const xmlChar *prefix,
+    const xmlChar *URI,
+    int nb_namespaces,
+    const xmlChar **namespaces,
+    int nb_attributes,
+    int nb_defaulted,
+    const xmlChar **attributes
+    )
+{
+    #ifdef DEBUG
+    fprintf (stderr, "Event: OnStartElementFb2Ns!\n");
+    #endif
+    xmlSAXHandlerPtr handler = ((xmlParserCtxtPtr)ctx)->sax;
+    Fb2Parser *parser = (Fb2Parser *)(handler->_private);
+    EpubInfo *info = parser->info;
+    const char *name = (const char *)localname;
+    if (g_strcmp0(name, "description") == 0) {
+        info->in_metadata = TRUE;
+        info->metadata_hash = FNV_OFFSET_BASIS;
+    }
+    if (!info->in_metadata)
+        return;
+    metadata_hash_tag(info, "<", name);
+    info->my_state = INIT;
+    g_string_truncate(info->text, 0);
+    if (g_strcmp0(name, "title-info") == 0) {
+        parser->in_title_info = TRUE;
+    } else if (g_strcmp0(name, "document-info") == 0) {
+        parser->in_document_info = TRUE;
+    } else if (parser->in_title_info) {
+        if (g_strcmp0(name, "author") == 0) {
+            parser->in_author = TRUE;
+            g_string_truncate(parser->author, 0);
+        } else if (parser->in_author
+                   && (g_strcmp0(name, "first-name") == 0
+                       || g_strcmp0(name, "middle-name") == 0
+                       || g_strcmp0(name, "last-name") == 0)) {
+            info->my_state = CREATOR_OPENED;
+        } else if (g_strcmp0(name, "book-title") == 0) {
+            info->my_state = BOOK_TITLE_OPENED;
+        } else if (g_strcmp0(name, "lang") == 0) {
+            info->my_state = LANG_OPENED;
+        }
+    } else if (parser->in_document_info && g_strcmp0(name, "id") == 0) {
+        info->my_state = IDENTIFIER_OPENED;
+    }
+}
+
+static void
+OnCharactersFb2(void *ctx,
+    const xmlChar *ch,
+    int len)
+{
+    xmlSAXHandlerPtr handler = ((xmlParserCtxtPtr)ctx)->sax;
+    Fb2Parser *parser = (Fb2Parser *)(handler->_private);
+    EpubInfo *info = parser->info;
+    if (info->in_metadata)
+        metadata_hash_text(info, ch, len);
+    switch (info->my_state) {
+    case CREATOR_OPENED:
+    case BOOK_TITLE_OPENED:
+    case LANG_OPENED:
+    case IDENTIFIER_OPENED:
+        append_text(info->text, ch, len);
+        break;
+    default:
+        break;
+    }
+}
+
+static void
+OnEndElementFb2Ns(
+    void* ctx,
+    const xmlChar* localname,
+    const xmlChar* prefix,
+    const xmlChar* URI
+    )
+{
+    #ifdef DEBUG
+    fprintf (stderr, "Event: OnEndElementFb2Ns!\n");
+    #endif
+    xmlSAXHandlerPtr handler = ((xmlParserCtxtPtr)ctx)->sax;
+    Fb2Parser *parser = (Fb2Parser *)(handler->_private);
+    EpubInfo *info = parser->info;
+    const char *name = (const char *)localname;
+    if (!info->in_metadata)
+        return;
+    metadata_hash_tag(info, ">", NULL);
+    if (info->my_state == CREATOR_OPENED) {
+        /* One part of the author's name */
+        g_strstrip(info->text->str);
+        if (info->text->str[0] != '\0') {
+            if (parser->author->len)
+                g_string_append_c(parser->author, ' ');
+            g_string_append(parser->author, info->text->str);
+        }
+        g_string_truncate(info->text, 0);
+        info->my_state = CREATOR_END;
+    }
+    info_commit_text(info);
+    info->my_state = INIT;
+    if (g_strcmp0(name, "title-info") == 0) {
+        parser->in_title_info = FALSE;
+    } else if (g_strcmp0(name, "document-info") == 0) {
+        parser->in_document_info = FALSE;
+    } else if (parser->in_author && g_strcmp0(name, "author") == 0) {
+        parser->in_author = FALSE;
+        if (parser->author->len)
+            g_ptr_array_add(info->creators, g_strdup(parser->author->str));
+    } else if (g_strcmp0(name, "description") == 0) {
+        /* The body is of no interest */
+        info->in_metadata = FALSE;
+        info->my_state = STOP;
+        xmlStopParser(ctx);
+    }
+}
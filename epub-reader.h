@@ -0,0 +1,72 @@
+#ifndef _EPUB_READER_
+#define _EPUB_READER_
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "epub-record.h"
+#include "epub-stream.h"
+
+/* ------- Start Epub only */
+#define MAX_STR_LEN 256
+#define ZIP_BUFFER_LEN 1024
+
+ enum FSM_State {
+    INIT,
+    BOOK_TITLE_OPENED,
+    BOOK_TITLE_END,
+    CREATOR_OPENED,
+    CREATOR_END,
+    LANG_OPENED,
+    LANG_END,
+    IDENTIFIER_OPENED,
+    IDENTIFIER_END,
+    STOP
+};
+
+typedef struct {
+    char contentFilename[MAX_STR_LEN];
+    enum FSM_State my_state;
+} AboutContainer;
+
+/* Result codes of read_from_epub(), see epub_strerror() */
+#define EPUB_OK             0
+#define EPUB_ERR_ZIP_OPEN   1 /* the record title holds the message */
+#define EPUB_ERR_ZIP_FOPEN  2
+#define EPUB_ERR_CONTAINER  3
+#define EPUB_ERR_OPF        4
+#define EPUB_ERR_ZIP_CLOSE  5
+#define EPUB_ERR_FORMAT     6 /* no EpubFormat recognised the file */
+#define EPUB_ERR_FB2        7
+#define EPUB_ERR_CORRUPT    8 /* see epub-verify.h */
+
+/* Safe to call from several threads at once. libxml2 is initialised by
+   the first book that gets as far as an XML member. *record is always
+   set, also on errors (content_hash may still be known); free it with
+   g_free(). */
+int read_from_epub(const char *archive, EpubRecord **record);
+/* Same for any seekable stream, e.g. a GVFS location that has no local
+   path. cancellable, if not NULL, aborts every read on the stream; io, if
+   not NULL, receives the bytes and round trips it took. */
+int read_from_epub_stream(GInputStream *stream, goffset size,
+                          GCancellable *cancellable, EpubRecord **record,
+                          EpubIoStats *io);
+int read_from_epub_file(GFile *file, GCancellable *cancellable,
+                        EpubRecord **record, EpubIoStats *io);
+
+/* FictionBook, plain and as the only book in a ZIP archive. The same
+   record fields are filled: book-title, authors, lang, document id. */
+int read_from_fb2(const char *path, EpubRecord **record);
+int read_from_fb2_stream(GInputStream *stream, goffset size,
+                         GCancellable *cancellable, EpubRecord **record,
+                         EpubIoStats *io);
+int read_from_fb2_zip(const char *archive, EpubRecord **record);
+int read_from_fb2_zip_stream(GInputStream *stream, goffset size,
+                             GCancellable *cancellable, EpubRecord **record,
+                             EpubIoStats *io);
+const char *epub_strerror(int code);
+/* xmlCleanupParser() if a reader initialised libxml2. Call once, after
+   the last reader has returned. */
+void epub_reader_cleanup(void);
+
+#endif /* _EPUB_READER_ */
@@ -0,0 +1,146 @@
+#include <string.h>
+
+#include <glib.h>
+
+#include "epub-record.h"
+#include "epub-stats.h"
+
+/* Length of s cut to at most EPUB_RECORD_MAX_TEXT - 1 bytes without
+   splitting a UTF-8 sequence */
+static gsize
+text_length(const char *s)
+{
+    if(!s)
+        return 0;
+    gsize len = strlen(s);
+    if(len < EPUB_RECORD_MAX_TEXT)
+        return len;
+    len = EPUB_RECORD_MAX_TEXT - 1;
+    while(len > 0 && ((guchar)s[len] & 0xc0) == 0x80)
+        --len;
+    return len;
+}
+
+static char *
+put_text(char *p, const char *s)
+{
+    const gsize len = text_length(s);
+    if(len)
+        memcpy(p, s, len);
+    p[len] = '\0';
+    return p + len + 1;
+}
+
+EpubRecord *
+epub_record_new(const char *title, const char *lang,
+                const char *const *creators, guint n_creators,
+                const char *const *identifiers, guint n_identifiers,
+                guint64 metadata_hash, guint64 content_hash)
+{
+    n_creators = MIN(n_creators, EPUB_RECORD_MAX_CREATORS);
+    n_identifiers = MIN(n_identifiers, EPUB_RECORD_MAX_IDENTIFIERS);
+    gsize size = sizeof(EpubRecord) + text_length(title) + 1
+                 + text_length(lang) + 1;
+    for(guint i = 0; i < n_creators; ++i)
+        size += text_length(creators[i]) + 1;
+    for(guint i = 0; i < n_identifiers; ++i)
+        size += text_length(identifiers[i]) + 1;
+
+    EpubRecord *record = g_malloc(size);
+    memset(record, 0, sizeof(EpubRecord));
+    record->metadata_hash = metadata_hash;
+    record->content_hash = content_hash;
+    record->size = (guint16)size;
+    record->n_creators = (guint8)n_creators;
+    record->n_identifiers = (guint8)n_identifiers;
+    char *base = (char *)record;
+    char *p = base + sizeof(EpubRecord);
+    record->title = (guint16)(p - base);
+    p = put_text(p, title);
+    record->lang = (guint16)(p - base);
+    p = put_text(p, lang);
+    record->creators = (guint16)(p - base);
+    for(guint i = 0; i < n_creators; ++i)
+        p = put_text(p, creators[i]);
+    record->identifiers = (guint16)(p - base);
+    for(guint i = 0; i < n_identifiers; ++i)
+        p = put_text(p, identifiers[i]);
+    epub_stats_add(EPUB_STAT_RECORD_BYTES, size);
+    return record;
+}
+
+EpubRecord *
+epub_record_copy(const EpubRecord *record)
+{
+    EpubRecord *copy = g_malloc(record->size);
+    memcpy(copy, record, record->size);
+    return copy;
+}
+
+/* Offset of the end of the count strings starting at offset, 0 if they
+   run past size */
+static gsize
+list_end(const char *base, gsize size, gsize offset, guint count)
+{
+    for(guint i = 0; i < count; ++i) {
+        if(offset >= size)
+            return 0;
+        const char *nul = memchr(base + offset, '\0', size - offset);
+        if(!nul)
+            return 0;
+        offset = (gsize)(nul - base) + 1;
+    }
+    return offset;
+}
+
+gboolean
+epub_record_validate(const void *data, gsize len)
+{
+    const EpubRecord *record = data;
+    const char *base = data;
+    if(len < sizeof(EpubRecord) || record->size < sizeof(EpubRecord)
+       || record->size > len)
+        return FALSE;
+    const gsize size = record->size;
+    return list_end(base, size, record->title, 1)
+           && list_end(base, size, record->lang, 1)
+           && (record->n_creators == 0
+               || list_end(base, size, record->creators, record->n_creators))
+           && (record->n_identifiers == 0
+               || list_end(base, size, record->identifiers, record->n_identifiers));
+}
+
+static const char *
+list_item(const EpubRecord *record, guint16 offset, guint n, guint i)
+{
+    g_return_val_if_fail(i < n, "");
+    const char *s = (const char *)record + offset;
+    while(i-- > 0)
+        s = epub_record_next(s);
+    return s;
+}
+
+const char *
+epub_record_creator(const EpubRecord *record, guint i)
+{
+    return list_item(record, record->creators, record->n_creators, i);
+}
+
+const char *
+epub_record_identifier(const EpubRecord *record, guint i)
+{
+    return list_item(record, record->identifiers, record->n_identifiers, i);
+}
+
+char *
+epub_record_join_creators(const EpubRecord *record, const char *separator)
+{
+    GString *out = g_string_new("");
+    const char *s = (const char *)record + record->creators;
+    for(guint i = 0; i < record->n_creators; ++i, s = epub_record_next(s)) {
+        if(i > 0)
+            g_string_append(out, separator);
+        g_string_append(out, s);
+    }
+    return g_string_free(out, FALSE);
+}
@@ -0,0 +1,70 @@
+#ifndef _EPUB_RECORD_
+#define _EPUB_RECORD_
+
+#include <string.h>
+#include <glib.h>
+
+/* What a reader found out about one book, as a single allocation: this
+   header followed by the NUL terminated strings it points to. Being flat
+   it is cached, handed between threads and stored in the library index
+   with a plain memcpy; free it with g_free().
+
+   Strings are never truncated below EPUB_RECORD_MAX_TEXT bytes, which no
+   real title reaches; the limits keep every offset within 16 bits. */
+
+#define EPUB_RECORD_MAX_TEXT 1024
+#define EPUB_RECORD_MAX_CREATORS 32
+#define EPUB_RECORD_MAX_IDENTIFIERS 16
+
+typedef struct {
+    /* Fingerprints for duplicate detection, 0 when unknown.
+       metadata_hash covers the OPF <metadata> element (names and text),
+       content_hash the (CRC32, size) pairs of the central directory. */
+    guint64 metadata_hash;
+    guint64 content_hash;
+    guint16 size;          /* of the whole record, header included */
+    guint16 title;         /* byte offsets from the start of the record */
+    guint16 lang;
+    guint16 creators;      /* n_creators strings back to back */
+    guint16 identifiers;   /* n_identifiers strings back to back */
+    guint8 n_creators;
+    guint8 n_identifiers;
+    guint16 reserved;
+} EpubRecord;
+
+/* NULL strings are stored as "". Lists longer than the limits above are
+   cut, strings are cut on a character boundary. */
+EpubRecord *epub_record_new(const char *title, const char *lang,
+                            const char *const *creators, guint n_creators,
+                            const char *const *identifiers, guint n_identifiers,
+                            guint64 metadata_hash, guint64 content_hash);
+EpubRecord *epub_record_copy(const EpubRecord *record);
+/* TRUE if the len bytes at data hold a well-formed record, for records
+   that come from a file */
+gboolean epub_record_validate(const void *data, gsize len);
+
+static inline const char *
+epub_record_title(const EpubRecord *record)
+{
+    return (const char *)record + record->title;
+}
+
+static inline const char *
+epub_record_lang(const EpubRecord *record)
+{
+    return (const char *)record + record->lang;
+}
+
+/* The string after s in a list */
+static inline const char *
+epub_record_next(const char *s)
+{
+    return s + strlen(s) + 1;
+}
+
+const char *epub_record_creator(const EpubRecord *record, guint i);
+const char *epub_record_identifier(const EpubRecord *record, guint i);
+/* All creators for display, e.g. "A, B" */
+char *epub_record_join_creators(const EpubRecord *record, const char *separator);
+
+#endif /* _EPUB_RECORD_ */
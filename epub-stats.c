@@ -0,0 +1,112 @@
+#include <stdio.h>
+
+#include <glib.h>
+
+#include "epub-stats.h"
+
+typedef struct {
+    guint64 count;
+    guint64 sum_us;
+    guint64 max_us;
+    guint64 buckets[EPUB_STATS_BUCKETS];
+} Histogram;
+
+static guint64 counters[EPUB_STAT_N_COUNTERS];
+static Histogram timers[EPUB_STAT_N_TIMERS];
+
+static const char *counter_names[EPUB_STAT_N_COUNTERS] = {
+    "books", "errors", "bytes_inflated", "cache_hits", "cache_misses",
+    "record_bytes", "bytes_verified", "index_hits"
+};
+
+static const char *timer_names[EPUB_STAT_N_TIMERS] = {
+    "queue_wait", "zip_open", "container_parse", "opf_parse", "main_loop",
+    "module_init", "first_use"
+};
+
+/* GLib only has 32 bit atomics, byte counts need 64 */
+#define ATOMIC_ADD(p, n) __atomic_fetch_add((p), (n), __ATOMIC_RELAXED)
+#define ATOMIC_LOAD(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+
+void
+epub_stats_add(EpubStatCounter counter, guint64 n)
+{
+    ATOMIC_ADD(&counters[counter], n);
+    EPUB_PROBE2(counter, (int)counter, n);
+}
+
+void
+epub_stats_record(EpubStatTimer timer, gint64 usec)
+{
+    if(usec < 0)
+        usec = 0;
+    Histogram *h = &timers[timer];
+    guint bucket = 0;
+    while(bucket + 1 < EPUB_STATS_BUCKETS && ((guint64)1 << bucket) <= (guint64)usec)
+        ++bucket;
+    ATOMIC_ADD(&h->count, 1);
+    ATOMIC_ADD(&h->sum_us, (guint64)usec);
+    ATOMIC_ADD(&h->buckets[bucket], 1);
+    guint64 max = ATOMIC_LOAD(&h->max_us);
+    while((guint64)usec > max
+          && !__atomic_compare_exchange_n(&h->max_us, &max, (guint64)usec, TRUE,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+    EPUB_PROBE2(timer, (int)timer, usec);
+}
+
+gint64
+epub_stats_record_since(EpubStatTimer timer, gint64 start)
+{
+    const gint64 now = epub_stats_now();
+    epub_stats_record(timer, now - start);
+    return now;
+}
+
+char *
+epub_stats_to_json(void)
+{
+    GString *out = g_string_new("{\n  \"counters\": {");
+    for(int i = 0; i < EPUB_STAT_N_COUNTERS; ++i)
+        g_string_append_printf(out, "%s\n    \"%s\": %" G_GUINT64_FORMAT,
+                               i ? "," : "", counter_names[i],
+                               (guint64)ATOMIC_LOAD(&counters[i]));
+    g_string_append(out, "\n  },\n  \"timers\": {");
+    for(int i = 0; i < EPUB_STAT_N_TIMERS; ++i) {
+        const Histogram *h = &timers[i];
+        g_string_append_printf(out, "%s\n    \"%s\": {\"count\": %" G_GUINT64_FORMAT
+                               ", \"sum_us\": %" G_GUINT64_FORMAT
+                               ", \"max_us\": %" G_GUINT64_FORMAT
+                               ", \"buckets\": [",
+                               i ? "," : "", timer_names[i],
+                               (guint64)ATOMIC_LOAD(&h->count),
+                               (guint64)ATOMIC_LOAD(&h->sum_us),
+                               (guint64)ATOMIC_LOAD(&h->max_us));
+        /* Only non-empty buckets, as [upper bound in us, count] */
+        gboolean first = TRUE;
+        for(int b = 0; b < EPUB_STATS_BUCKETS; ++b) {
+            const guint64 n = ATOMIC_LOAD(&h->buckets[b]);
+            if(!n)
+                continue;
+            g_string_append_printf(out, "%s[%" G_GUINT64_FORMAT ", %" G_GUINT64_FORMAT "]",
+                                   first ? "" : ", ", (guint64)1 << b, n);
+            first = FALSE;
+        }
+        g_string_append(out, "]}");
+    }
+    g_string_append(out, "\n  }\n}\n");
+    return g_string_free(out, FALSE);
+}
+
+gboolean
+epub_stats_dump(const char *filename, GError **error)
+{
+    char *json = epub_stats_to_json();
+    gboolean ok = TRUE;
+    if(g_strcmp0(filename, "-") == 0)
+        fputs(json, stderr);
+    else
+        ok = g_file_set_contents(filename, json, -1, error);
+    g_free(json);
+    return ok;
+}
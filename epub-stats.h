@@ -0,0 +1,67 @@
+#ifndef _EPUB_STATS_
+#define _EPUB_STATS_
+
+#include <glib.h>
+
+/* Process wide performance counters and latency histograms.
+
+   Recording is a couple of relaxed atomic adds, cheap enough to stay on
+   in release builds. epub_stats_dump() writes everything as JSON; the
+   module does that on SIGUSR2 and epub-tool on exit, to the file named by
+   EPUB_STATS_FILE. */
+
+#define EPUB_STATS_ENV "EPUB_STATS_FILE"
+
+typedef enum {
+    EPUB_STAT_QUEUE_WAIT,      /* pushed to a pool until a worker starts */
+    EPUB_STAT_ZIP_OPEN,
+    EPUB_STAT_CONTAINER_PARSE, /* META-INF/container.xml */
+    EPUB_STAT_OPF_PARSE,
+    EPUB_STAT_MAIN_LOOP,       /* time spent per main loop callback */
+    EPUB_STAT_MODULE_INIT,     /* nautilus_module_initialize() */
+    EPUB_STAT_FIRST_USE,       /* setup deferred to first use, per stage */
+    EPUB_STAT_N_TIMERS
+} EpubStatTimer;
+
+typedef enum {
+    EPUB_STAT_BOOKS,
+    EPUB_STAT_ERRORS,
+    EPUB_STAT_BYTES_INFLATED,  /* member bytes handed to the XML parser */
+    EPUB_STAT_CACHE_HITS,
+    EPUB_STAT_CACHE_MISSES,
+    EPUB_STAT_RECORD_BYTES,    /* EpubRecord sizes, per book: / books */
+    EPUB_STAT_BYTES_VERIFIED,  /* inflated by epub-verify.c */
+    EPUB_STAT_INDEX_HITS,      /* books the module took from a library index */
+    EPUB_STAT_N_COUNTERS
+} EpubStatCounter;
+
+/* Histogram bucket i counts durations below 2^i microseconds */
+#define EPUB_STATS_BUCKETS 32
+
+/* Optional USDT probes, build with -DEPUB_SDT (make SDT=1) and list them
+   with e.g. `perf list sdt_nautilus_epub:*` after `perf buildid-cache
+   --add`. timer(id, usec) and counter(id, n) fire on every record. */
+#ifdef EPUB_SDT
+#include <sys/sdt.h>
+#define EPUB_PROBE2(name, a, b) DTRACE_PROBE2(nautilus_epub, name, a, b)
+#else
+#define EPUB_PROBE2(name, a, b) do {} while(0)
+#endif
+
+static inline gint64
+epub_stats_now(void)
+{
+    return g_get_monotonic_time();
+}
+
+void epub_stats_add(EpubStatCounter counter, guint64 n);
+void epub_stats_record(EpubStatTimer timer, gint64 usec);
+/* Records the time since start, returns the current time so phases
+   can be chained */
+gint64 epub_stats_record_since(EpubStatTimer timer, gint64 start);
+
+/* "-" writes to stderr. */
+gboolean epub_stats_dump(const char *filename, GError **error);
+char *epub_stats_to_json(void);
+
+#endif /* _EPUB_STATS_ */
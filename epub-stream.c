@@ -0,0 +1,192 @@
+#include <errno.h>
+#include <string.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <zip.h>
+
+#include "epub-stream.h"
+
+typedef struct {
+    GInputStream *stream;
+    goffset size;
+    goffset offset;          /* libzip's position */
+    goffset stream_offset;   /* position of the underlying stream */
+    guint8 *window;
+    gsize window_alloc;
+    goffset window_start;
+    gsize window_len;
+    GCancellable *cancellable;
+    EpubIoStats *stats;
+    zip_error_t error;
+} GioSource;
+
+static zip_int64_t gio_source_callback(void *userdata, void *data,
+                                       zip_uint64_t len, zip_source_cmd_t cmd);
+
+zip_source_t *
+epub_zip_source_new(GInputStream *stream, goffset size,
+                    GCancellable *cancellable, EpubIoStats *stats,
+                    zip_error_t *error)
+{
+    if(!G_IS_SEEKABLE(stream) || !g_seekable_can_seek(G_SEEKABLE(stream))) {
+        zip_error_set(error, ZIP_ER_SEEK, ESPIPE);
+        return NULL;
+    }
+    GioSource *src = g_new0(GioSource, 1);
+    src->stream = g_object_ref(stream);
+    src->size = size;
+    src->stream_offset = g_seekable_tell(G_SEEKABLE(stream));
+    src->cancellable = cancellable ? g_object_ref(cancellable) : NULL;
+    src->stats = stats;
+    zip_error_init(&src->error);
+    zip_source_t *zs = zip_source_function_create(gio_source_callback, src, error);
+    if(!zs) {
+        g_object_unref(src->stream);
+        g_clear_object(&src->cancellable);
+        g_free(src);
+    }
+    return zs;
+}
+
+GInputStream *
+epub_file_read(GFile *file, GCancellable *cancellable, goffset *size,
+               GError **error)
+{
+    GFileInputStream *stream = g_file_read(file, cancellable, error);
+    if(!stream)
+        return NULL;
+    GFileInfo *file_info = g_file_input_stream_query_info(stream,
+                                                          G_FILE_ATTRIBUTE_STANDARD_SIZE,
+                                                          cancellable, NULL);
+    if(!file_info)
+        file_info = g_file_query_info(file, G_FILE_ATTRIBUTE_STANDARD_SIZE,
+                                      G_FILE_QUERY_INFO_NONE, cancellable, error);
+    if(!file_info) {
+        g_object_unref(stream);
+        return NULL;
+    }
+    *size = g_file_info_get_size(file_info);
+    g_object_unref(file_info);
+    return G_INPUT_STREAM(stream);
+}
+
+/* Fill the window with at least len bytes starting at offset */
+static gboolean
+gio_source_fill(GioSource *src, goffset offset, gsize len)
+{
+    GError *gerror = NULL;
+    gsize want = MAX(len, (gsize)EPUB_STREAM_WINDOW);
+    if((goffset)want > src->size - offset)
+        want = (gsize)(src->size - offset);
+    if(want > src->window_alloc) {
+        src->window = g_realloc(src->window, want);
+        src->window_alloc = want;
+    }
+    src->window_start = offset;
+    src->window_len = 0;
+    if(src->stream_offset != offset) {
+        if(!g_seekable_seek(G_SEEKABLE(src->stream), offset, G_SEEK_SET,
+                            src->cancellable, &gerror)) {
+            zip_error_set(&src->error, ZIP_ER_SEEK, EIO);
+            g_error_free(gerror);
+            return FALSE;
+        }
+        src->stream_offset = offset;
+        if(src->stats)
+            ++src->stats->round_trips;
+    }
+    while(src->window_len < want) {
+        const gssize n = g_input_stream_read(src->stream,
+                                             src->window + src->window_len,
+                                             want - src->window_len,
+                                             src->cancellable, &gerror);
+        if(src->stats)
+            ++src->stats->round_trips;
+        if(n < 0) {
+            zip_error_set(&src->error, ZIP_ER_READ, EIO);
+            g_error_free(gerror);
+            return FALSE;
+        }
+        if(n == 0)
+            break;
+        src->window_len += n;
+        src->stream_offset += n;
+        if(src->stats)
+            src->stats->bytes_read += n;
+    }
+    return TRUE;
+}
+
+static zip_int64_t
+gio_source_read(GioSource *src, void *data, zip_uint64_t len)
+{
+    if(src->offset >= src->size || len == 0)
+        return 0;
+    if(len > (zip_uint64_t)(src->size - src->offset))
+        len = src->size - src->offset;
+    const gboolean hit = src->offset >= src->window_start
+                         && src->offset + (goffset)len
+                            <= src->window_start + (goffset)src->window_len;
+    if(!hit && !gio_source_fill(src, src->offset, len))
+        return -1;
+    const gsize skip = (gsize)(src->offset - src->window_start);
+    if(skip >= src->window_len)
+        return 0;
+    len = MIN(len, src->window_len - skip);
+    memcpy(data, src->window + skip, len);
+    src->offset += len;
+    return (zip_int64_t)len;
+}
+
+static zip_int64_t
+gio_source_callback(void *userdata, void *data, zip_uint64_t len,
+                    zip_source_cmd_t cmd)
+{
+    GioSource *src = userdata;
+    switch(cmd) {
+    case ZIP_SOURCE_OPEN:
+        src->offset = 0;
+        return 0;
+    case ZIP_SOURCE_READ:
+        return gio_source_read(src, data, len);
+    case ZIP_SOURCE_CLOSE:
+        return 0;
+    case ZIP_SOURCE_STAT: {
+        zip_stat_t *st = data;
+        zip_stat_init(st);
+        st->size = src->size;
+        st->valid |= ZIP_STAT_SIZE;
+        return sizeof(*st);
+        }
+    case ZIP_SOURCE_ERROR:
+        return zip_error_to_data(&src->error, data, len);
+    case ZIP_SOURCE_SEEK: {
+        const zip_int64_t offset = zip_source_seek_compute_offset(
+            (zip_uint64_t)src->offset, (zip_uint64_t)src->size, data, len,
+            &src->error);
+        if(offset < 0)
+            return -1;
+        src->offset = offset;
+        return 0;
+        }
+    case ZIP_SOURCE_TELL:
+        return src->offset;
+    case ZIP_SOURCE_SUPPORTS:
+        return zip_source_make_command_bitmap(ZIP_SOURCE_OPEN, ZIP_SOURCE_READ,
+                                              ZIP_SOURCE_CLOSE, ZIP_SOURCE_STAT,
+                                              ZIP_SOURCE_ERROR, ZIP_SOURCE_SEEK,
+                                              ZIP_SOURCE_TELL, ZIP_SOURCE_SUPPORTS,
+                                              ZIP_SOURCE_FREE, -1);
+    case ZIP_SOURCE_FREE:
+        zip_error_fini(&src->error);
+        g_object_unref(src->stream);
+        g_clear_object(&src->cancellable);
+        g_free(src->window);
+        g_free(src);
+        return 0;
+    default:
+        zip_error_set(&src->error, ZIP_ER_OPNOTSUPP, 0);
+        return -1;
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef _EPUB_STREAM_
+#define _EPUB_STREAM_
+
+#include <gio/gio.h>
+#include <zip.h>
+
+/* I/O done through an epub_zip_source_new() source */
+typedef struct {
+    guint64 bytes_read;
+    guint round_trips;  /* seeks that moved the position plus reads */
+} EpubIoStats;
+
+/* Read-ahead window. libzip issues many small reads (local headers,
+   8 KiB inflate input); on a remote location each one would be a round
+   trip, so they are served from one larger read. */
+#define EPUB_STREAM_WINDOW (64 * 1024)
+
+/* libzip source over a seekable stream of the given size. Only the ranges
+   libzip asks for are fetched: the end of central directory record, the
+   central directory and the members that are actually opened. The source
+   takes a reference on stream and on cancellable, which aborts every seek
+   and read; cancellable and stats may be NULL. */
+zip_source_t *epub_zip_source_new(GInputStream *stream, goffset size,
+                                  GCancellable *cancellable,
+                                  EpubIoStats *stats, zip_error_t *error);
+
+/* g_file_read() plus the file size, which not every GVFS backend reports
+   on an open stream */
+GInputStream *epub_file_read(GFile *file, GCancellable *cancellable,
+                             goffset *size, GError **error);
+
+#endif /* _EPUB_STREAM_ */
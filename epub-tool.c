@@ -0,0 +1,595 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "epub-bench.h"
+#include "epub-format.h"
+#include "epub-reader.h"
+#include "epub-index.h"
+#include "epub-stats.h"
+#include "epub-verify.h"
+
+/* Command line front end for the library index */
+
+static int cmd_index(int argc, char **argv);
+static int cmd_query(int argc, char **argv);
+static int cmd_dups(int argc, char **argv);
+static int cmd_probe(int argc, char **argv);
+static int cmd_corpus(int argc, char **argv);
+static int cmd_bench(int argc, char **argv);
+static int cmd_verify(int argc, char **argv);
+
+static const struct {
+    const char *name;
+    int (*run)(int argc, char **argv);
+    const char *help;
+} commands[] = {
+    {"index", cmd_index, "DIR INDEX      scan DIR and update INDEX"},
+    {"query", cmd_query, "INDEX          print matching books"},
+    {"dups", cmd_dups,   "INDEX           print groups of duplicate books"},
+    {"probe", cmd_probe, "FILE|URI...    show the I/O needed per book"},
+    {"corpus", cmd_corpus, "DIR           write a synthetic corpus to DIR"},
+    {"bench", cmd_bench, "DIR            measure parse throughput over DIR"},
+    {"verify", cmd_verify, "FILE...       check the CRC of every archive member"},
+};
+
+static int
+usage(void)
+{
+    fprintf(stderr, "Usage:\n");
+    for(size_t i = 0; i < G_N_ELEMENTS(commands); ++i)
+        fprintf(stderr, "  epub-tool %s %s\n", commands[i].name, commands[i].help);
+    fprintf(stderr, "Run epub-tool COMMAND --help for options.\n");
+    return 2;
+}
+
+/* Parses argv with the given entries, argv[0] is the command name */
+static gboolean
+parse_options(int *argc, char ***argv, const char *parameter,
+              const GOptionEntry *entries)
+{
+    GError *error = NULL;
+    GOptionContext *context = g_option_context_new(parameter);
+    g_option_context_add_main_entries(context, entries, NULL);
+    const gboolean ok = g_option_context_parse(context, argc, argv, &error);
+    if(!ok) {
+        fprintf(stderr, "epub-tool: %s\n", error->message);
+        g_error_free(error);
+    }
+    g_option_context_free(context);
+    return ok;
+}
+
+static int
+cmd_index(int argc, char **argv)
+{
+    gint n_threads = 0;
+    gboolean verify = FALSE;
+    const GOptionEntry entries[] = {
+        {"jobs", 'j', 0, G_OPTION_ARG_INT, &n_threads,
+         "Number of parser threads (default: one per CPU)", "N"},
+        {"verify", 0, 0, G_OPTION_ARG_NONE, &verify,
+         "Check every member of archives not verified before", NULL},
+        {NULL}
+    };
+    if(!parse_options(&argc, &argv, "DIR INDEX", entries))
+        return 2;
+    if(argc != 3 || n_threads < 0)
+        return usage();
+
+    EpubIndexStats stats;
+    GError *error = NULL;
+    const gint64 start = g_get_monotonic_time();
+    if(!epub_index_update(argv[1], argv[2], (guint)n_threads,
+                          verify ? EPUB_INDEX_VERIFY : 0, &stats, &error)) {
+        fprintf(stderr, "epub-tool: %s\n", error->message);
+        g_error_free(error);
+        return 1;
+    }
+    fprintf(stderr, "%u files: %u parsed, %u unchanged, %u failed in %.3f s\n",
+            stats.n_files, stats.n_parsed, stats.n_reused, stats.n_failed,
+            (g_get_monotonic_time() - start) / 1e6);
+    if(verify)
+        fprintf(stderr, "%u archives verified, %u corrupt\n",
+                stats.n_verified, stats.n_corrupt);
+    return 0;
+}
+
+static void
+print_record(const EpubIndex *index, const EpubIndexRecord *record)
+{
+    if(record->status != EPUB_OK) {
+        printf("%s\t!%s\n", epub_index_get_string(index, record->path),
+               epub_strerror(record->status));
+        return;
+    }
+    const EpubRecord *book = epub_index_get_book(index, record);
+    char *creators = epub_record_join_creators(book, ", ");
+    printf("%s\t%s\t%s\t%s\n",
+           epub_index_get_string(index, record->path),
+           epub_record_title(book), creators, epub_record_lang(book));
+    g_free(creators);
+}
+
+/* entries is sorted, as returned by epub_index_lookup() */
+static gboolean
+contains_entry(const GArray *entries, guint entry)
+{
+    guint lo = 0, hi = entries->len;
+    while(lo < hi) {
+        const guint mid = lo + (hi - lo) / 2;
+        const guint value = g_array_index(entries, guint, mid);
+        if(value == entry)
+            return TRUE;
+        if(value < entry)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return FALSE;
+}
+
+static int
+cmd_query(int argc, char **argv)
+{
+    char *creator = NULL;
+    char *lang = NULL;
+    char *identifier = NULL;
+    gboolean missing_title = FALSE;
+    gboolean failed = FALSE;
+    gboolean count = FALSE;
+    const GOptionEntry entries[] = {
+        {"creator", 'c', 0, G_OPTION_ARG_STRING, &creator,
+         "Books by this creator (case-insensitive)", "NAME"},
+        {"lang", 'l', 0, G_OPTION_ARG_STRING, &lang,
+         "Books whose language starts with CODE, e.g. en", "CODE"},
+        {"identifier", 'i', 0, G_OPTION_ARG_STRING, &identifier,
+         "Books with this dc:identifier", "ID"},
+        {"missing-title", 't', 0, G_OPTION_ARG_NONE, &missing_title,
+         "Readable books without a title", NULL},
+        {"failed", 'f', 0, G_OPTION_ARG_NONE, &failed,
+         "Books that could not be read", NULL},
+        {"count", 'n', 0, G_OPTION_ARG_NONE, &count,
+         "Print only the number of matches", NULL},
+        {NULL}
+    };
+    if(!parse_options(&argc, &argv, "INDEX", entries))
+        return 2;
+    if(argc != 2)
+        return usage();
+
+    GError *error = NULL;
+    EpubIndex *index = epub_index_open(argv[1], &error);
+    if(!index) {
+        fprintf(stderr, "epub-tool: %s\n", error->message);
+        g_error_free(error);
+        return 1;
+    }
+    /* Start from the most selective secondary index, filter the rest */
+    GArray *candidates = NULL;
+    if(identifier)
+        candidates = epub_index_lookup(index, EPUB_INDEX_BY_IDENTIFIER, identifier, FALSE);
+    else if(creator)
+        candidates = epub_index_lookup(index, EPUB_INDEX_BY_CREATOR, creator, FALSE);
+    else if(lang)
+        candidates = epub_index_lookup(index, EPUB_INDEX_BY_LANG, lang, TRUE);
+    GArray *by_creator = creator && identifier
+                         ? epub_index_lookup(index, EPUB_INDEX_BY_CREATOR, creator, FALSE)
+                         : NULL;
+    char *lang_folded = lang ? g_utf8_casefold(lang, -1) : NULL;
+
+    const guint n = candidates ? candidates->len : epub_index_get_n_entries(index);
+    guint matches = 0;
+    for(guint i = 0; i < n; ++i) {
+        const guint entry = candidates ? g_array_index(candidates, guint, i) : i;
+        const EpubIndexRecord *record = epub_index_get_record(index, entry);
+        const EpubRecord *book = epub_index_get_book(index, record);
+        if(by_creator && !contains_entry(by_creator, entry))
+            continue;
+        if(lang && (creator || identifier)) {
+            char *folded = g_utf8_casefold(epub_record_lang(book), -1);
+            const gboolean match = g_str_has_prefix(folded, lang_folded);
+            g_free(folded);
+            if(!match)
+                continue;
+        }
+        if(missing_title && (record->status != EPUB_OK
+                             || *epub_record_title(book)))
+            continue;
+        if(failed && record->status == EPUB_OK)
+            continue;
+        ++matches;
+        if(!count)
+            print_record(index, record);
+    }
+    if(count)
+        printf("%u\n", matches);
+
+    g_free(lang_folded);
+    if(by_creator)
+        g_array_unref(by_creator);
+    if(candidates)
+        g_array_unref(candidates);
+    epub_index_close(index);
+    g_free(creator);
+    g_free(lang);
+    g_free(identifier);
+    return 0;
+}
+
+static int
+cmd_dups(int argc, char **argv)
+{
+    char *by = NULL;
+    const GOptionEntry entries[] = {
+        {"by", 'b', 0, G_OPTION_ARG_STRING, &by,
+         "Comma separated criteria: identifier, content, metadata "
+         "(default: all)", "LIST"},
+        {NULL}
+    };
+    if(!parse_options(&argc, &argv, "INDEX", entries))
+        return 2;
+    if(argc != 2)
+        return usage();
+
+    EpubDuplicateFlags flags = 0;
+    if(by) {
+        char **names = g_strsplit(by, ",", -1);
+        for(char **name = names; *name; ++name) {
+            if(strcmp(*name, "identifier") == 0)
+                flags |= EPUB_DUP_IDENTIFIER;
+            else if(strcmp(*name, "content") == 0)
+                flags |= EPUB_DUP_CONTENT;
+            else if(strcmp(*name, "metadata") == 0)
+                flags |= EPUB_DUP_METADATA;
+            else {
+                fprintf(stderr, "epub-tool: unknown criterion '%s'\n", *name);
+                g_strfreev(names);
+                g_free(by);
+                return 2;
+            }
+        }
+        g_strfreev(names);
+        g_free(by);
+    } else {
+        flags = EPUB_DUP_IDENTIFIER | EPUB_DUP_CONTENT | EPUB_DUP_METADATA;
+    }
+
+    GError *error = NULL;
+    EpubIndex *index = epub_index_open(argv[1], &error);
+    if(!index) {
+        fprintf(stderr, "epub-tool: %s\n", error->message);
+        g_error_free(error);
+        return 1;
+    }
+    GPtrArray *groups = epub_index_find_duplicates(index, flags);
+    /* Groups are separated by an empty line */
+    for(guint i = 0; i < groups->len; ++i) {
+        const GArray *group = g_ptr_array_index(groups, i);
+        if(i > 0)
+            printf("\n");
+        for(guint j = 0; j < group->len; ++j)
+            print_record(index, epub_index_get_record(index, g_array_index(group, guint, j)));
+    }
+    g_ptr_array_unref(groups);
+    epub_index_close(index);
+    return 0;
+}
+
+static int
+cmd_corpus(int argc, char **argv)
+{
+    gint n_books = 2000;
+    gint seed = 1;
+    const GOptionEntry entries[] = {
+        {"books", 'n', 0, G_OPTION_ARG_INT, &n_books,
+         "Number of books (default: 2000)", "N"},
+        {"seed", 's', 0, G_OPTION_ARG_INT, &seed,
+         "Random seed, the same seed gives the same corpus", "SEED"},
+        {NULL}
+    };
+    if(!parse_options(&argc, &argv, "DIR", entries))
+        return 2;
+    if(argc != 2 || n_books < 0)
+        return usage();
+
+    GError *error = NULL;
+    if(!epub_bench_make_corpus(argv[1], (guint)n_books, (guint32)seed, &error)) {
+        fprintf(stderr, "epub-tool: %s\n", error->message);
+        g_error_free(error);
+        return 1;
+    }
+    return 0;
+}
+
+static int
+cmd_bench(int argc, char **argv)
+{
+    gint rounds = 5;
+    gint n_threads = 1;
+    const GOptionEntry entries[] = {
+        {"rounds", 'r', 0, G_OPTION_ARG_INT, &rounds,
+         "Read the corpus this many times, the best round counts (default: 5)",
+         "N"},
+        {"jobs", 'j', 0, G_OPTION_ARG_INT, &n_threads,
+         "Parser threads, 0 for one per CPU (default: 1)", "N"},
+        {NULL}
+    };
+    if(!parse_options(&argc, &argv, "DIR", entries))
+        return 2;
+    if(argc != 2 || rounds < 1 || n_threads < 0)
+        return usage();
+
+    EpubBenchResult result;
+    GError *error = NULL;
+    if(!epub_bench_run(argv[1], (guint)rounds, (guint)n_threads, &result, &error)) {
+        fprintf(stderr, "epub-tool: %s\n", error->message);
+        g_error_free(error);
+        return 1;
+    }
+    /* One line, make pgo-report puts them side by side */
+    printf("# books\tfailed\tMB\tbest s\tmean s\tbooks/s\tMB/s\n");
+    printf("%u\t%u\t%.1f\t%.3f\t%.3f\t%.0f\t%.1f\n",
+           result.n_books, result.n_failed, result.bytes / 1e6,
+           result.best_seconds, result.mean_seconds,
+           result.n_books / result.best_seconds,
+           result.bytes / 1e6 / result.best_seconds);
+    return result.n_failed ? 1 : 0;
+}
+
+static int
+cmd_verify(int argc, char **argv)
+{
+    gint n_threads = 0;
+    const GOptionEntry entries[] = {
+        {"jobs", 'j', 0, G_OPTION_ARG_INT, &n_threads,
+         "Number of inflate threads (default: one per CPU)", "N"},
+        {NULL}
+    };
+    if(!parse_options(&argc, &argv, "FILE...", entries))
+        return 2;
+    if(argc < 2 || n_threads < 0)
+        return usage();
+
+    const guint n = (guint)argc - 1;
+    EpubVerifyResult *results = g_new(EpubVerifyResult, n);
+    const gint64 start = g_get_monotonic_time();
+    epub_verify_archives((const char *const *)argv + 1, n, (guint)n_threads,
+                         results);
+    const gdouble seconds = (g_get_monotonic_time() - start) / 1e6;
+
+    guint failures = 0;
+    guint64 bytes = 0;
+    printf("# file\tmembers\tbad\tskipped\tMB\tresult\n");
+    for(guint i = 0; i < n; ++i) {
+        const EpubVerifyResult *r = &results[i];
+        printf("%s\t%u\t%u\t%u\t%.1f\t%s%s%s\n", argv[i + 1], r->n_entries,
+               r->n_bad, r->n_skipped, r->bytes / 1e6, epub_strerror(r->status),
+               r->first_bad ? ": " : "", r->first_bad ? r->first_bad : "");
+        bytes += r->bytes;
+        if(r->status != EPUB_OK)
+            ++failures;
+        epub_verify_result_clear(&results[i]);
+    }
+    g_free(results);
+    fprintf(stderr, "%u files, %u bad, %.1f MB inflated in %.3f s, %.1f MB/s\n",
+            n, failures, bytes / 1e6, seconds,
+            seconds > 0 ? bytes / 1e6 / seconds : 0.0);
+    return failures ? 1 : 0;
+}
+
+int
+main(int argc, char **argv)
+{
+    if(argc < 2)
+        return usage();
+    int result = -1;
+    for(size_t i = 0; i < G_N_ELEMENTS(commands); ++i) {
+        if(strcmp(argv[1], commands[i].name) == 0) {
+            result = commands[i].run(argc - 1, argv + 1);
+            break;
+        }
+    }
+    epub_reader_cleanup();
+    const char *stats_file = g_getenv(EPUB_STATS_ENV);
+    if(result >= 0 && stats_file) {
+        GError *error = NULL;
+        if(!epub_stats_dump(stats_file, &error)) {
+            fprintf(stderr, "epub-tool: %s\n", error->message);
+            g_error_free(error);
+        }
+    }
+    return result < 0 ? usage() : result;
+}
+
+/* A stand-in for a remote GVFS location: every read and every seek waits
+   for latency, reads are additionally limited to a bandwidth. */
+
+typedef struct {
+    GFilterInputStream parent_instance;
+    gulong latency_us;
+    guint64 bytes_per_second;
+} EpubThrottledStream;
+
+typedef struct {
+    GFilterInputStreamClass parent_class;
+} EpubThrottledStreamClass;
+
+static void epub_throttled_stream_seekable_iface_init(GSeekableIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE(EpubThrottledStream, epub_throttled_stream,
+                        G_TYPE_FILTER_INPUT_STREAM,
+                        G_IMPLEMENT_INTERFACE(G_TYPE_SEEKABLE,
+                                              epub_throttled_stream_seekable_iface_init))
+
+static GInputStream *
+throttled_base(gpointer stream)
+{
+    return g_filter_input_stream_get_base_stream(G_FILTER_INPUT_STREAM(stream));
+}
+
+static gssize
+epub_throttled_stream_read(GInputStream *stream, void *buffer, gsize count,
+                           GCancellable *cancellable, GError **error)
+{
+    EpubThrottledStream *self = (EpubThrottledStream *)stream;
+    g_usleep(self->latency_us);
+    const gssize n = g_input_stream_read(throttled_base(stream), buffer, count,
+                                         cancellable, error);
+    if(n > 0 && self->bytes_per_second)
+        g_usleep((gulong)(n * G_USEC_PER_SEC / self->bytes_per_second));
+    return n;
+}
+
+static goffset
+epub_throttled_stream_tell(GSeekable *seekable)
+{
+    return g_seekable_tell(G_SEEKABLE(throttled_base(seekable)));
+}
+
+static gboolean
+epub_throttled_stream_can_seek(GSeekable *seekable)
+{
+    return g_seekable_can_seek(G_SEEKABLE(throttled_base(seekable)));
+}
+
+static gboolean
+epub_throttled_stream_seek(GSeekable *seekable, goffset offset, GSeekType type,
+                           GCancellable *cancellable, GError **error)
+{
+    g_usleep(((EpubThrottledStream *)seekable)->latency_us);
+    return g_seekable_seek(G_SEEKABLE(throttled_base(seekable)), offset, type,
+                           cancellable, error);
+}
+
+static gboolean
+epub_throttled_stream_can_truncate(GSeekable *seekable)
+{
+    return FALSE;
+}
+
+static gboolean
+epub_throttled_stream_truncate(GSeekable *seekable, goffset offset,
+                               GCancellable *cancellable, GError **error)
+{
+    g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                        "Cannot truncate a read-only stream");
+    return FALSE;
+}
+
+static void
+epub_throttled_stream_seekable_iface_init(GSeekableIface *iface)
+{
+    iface->tell = epub_throttled_stream_tell;
+    iface->can_seek = epub_throttled_stream_can_seek;
+    iface->seek = epub_throttled_stream_seek;
+    iface->can_truncate = epub_throttled_stream_can_truncate;
+    iface->truncate_fn = epub_throttled_stream_truncate;
+}
+
+static void
+epub_throttled_stream_class_init(EpubThrottledStreamClass *klass)
+{
+    G_INPUT_STREAM_CLASS(klass)->read_fn = epub_throttled_stream_read;
+}
+
+static void
+epub_throttled_stream_init(EpubThrottledStream *self)
+{
+}
+
+static GInputStream *
+epub_throttled_stream_new(GInputStream *base, gulong latency_us,
+                          guint64 bytes_per_second)
+{
+    EpubThrottledStream *self = g_object_new(epub_throttled_stream_get_type(),
+                                             "base-stream", base, NULL);
+    self->latency_us = latency_us;
+    self->bytes_per_second = bytes_per_second;
+    return G_INPUT_STREAM(self);
+}
+
+static int
+cmd_probe(int argc, char **argv)
+{
+    gint latency_ms = 0;
+    gint bandwidth_kib = 0;
+    const GOptionEntry entries[] = {
+        {"latency", 'l', 0, G_OPTION_ARG_INT, &latency_ms,
+         "Simulated delay per read and seek", "MS"},
+        {"bandwidth", 'b', 0, G_OPTION_ARG_INT, &bandwidth_kib,
+         "Simulated bandwidth (default: unlimited)", "KIB_PER_S"},
+        {NULL}
+    };
+    if(!parse_options(&argc, &argv, "FILE|URI...", entries))
+        return 2;
+    if(argc < 2 || latency_ms < 0 || bandwidth_kib < 0)
+        return usage();
+
+    int failures = 0;
+    guint64 total_size = 0, total_read = 0;
+    guint total_trips = 0;
+    guint64 total_record = 0;
+    guint n_books = 0;
+    printf("# file\tsize\tbytes read\tround trips\tms\trecord bytes\tresult\n");
+    for(int i = 1; i < argc; ++i) {
+        GFile *file = g_file_new_for_commandline_arg(argv[i]);
+        GError *error = NULL;
+        GFileInputStream *file_stream = g_file_read(file, NULL, &error);
+        GFileInfo *file_info = file_stream
+            ? g_file_query_info(file, G_FILE_ATTRIBUTE_STANDARD_SIZE,
+                                G_FILE_QUERY_INFO_NONE, NULL, &error)
+            : NULL;
+        if(!file_info) {
+            fprintf(stderr, "epub-tool: %s: %s\n", argv[i], error->message);
+            g_error_free(error);
+            if(file_stream)
+                g_object_unref(file_stream);
+            g_object_unref(file);
+            ++failures;
+            continue;
+        }
+        const goffset size = g_file_info_get_size(file_info);
+        GInputStream *stream = G_INPUT_STREAM(file_stream);
+        if(latency_ms || bandwidth_kib)
+            stream = epub_throttled_stream_new(stream, (gulong)latency_ms * 1000,
+                                               (guint64)bandwidth_kib * 1024);
+        else
+            g_object_ref(stream);
+
+        EpubRecord *book;
+        EpubIoStats io = {0, 0};
+        const gint64 start = g_get_monotonic_time();
+        const int result = read_book_stream(stream, size,
+                                            epub_format_suffix_hint(argv[i]),
+                                            NULL, &book, &io);
+        const gint64 elapsed = g_get_monotonic_time() - start;
+        printf("%s\t%" G_GINT64_FORMAT "\t%" G_GUINT64_FORMAT "\t%u\t%.1f\t%u\t%s\n",
+               argv[i], (gint64)size, io.bytes_read, io.round_trips,
+               elapsed / 1000.0, (guint)book->size, epub_strerror(result));
+        total_record += book->size;
+        ++n_books;
+        g_free(book);
+        total_size += size;
+        total_read += io.bytes_read;
+        total_trips += io.round_trips;
+        if(result != EPUB_OK)
+            ++failures;
+
+        g_object_unref(stream);
+        g_object_unref(file_stream);
+        g_object_unref(file_info);
+        g_object_unref(file);
+    }
+    if(total_size)
+        fprintf(stderr, "%" G_GUINT64_FORMAT " of %" G_GUINT64_FORMAT
+                " bytes read (%.1f%%), %u round trips\n",
+                total_read, total_size, 100.0 * total_read / total_size,
+                total_trips);
+    if(n_books)
+        fprintf(stderr, "%.1f record bytes per book\n",
+                (double)total_record / n_books);
+    return failures ? 1 : 0;
+}
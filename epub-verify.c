@@ -0,0 +1,320 @@
+#include <errno.h>
+#include <string.h>
+
+#include <glib.h>
+#include <zip.h>
+#include <zlib.h>
+
+#include "epub-reader.h"
+#include "epub-stats.h"
+#include "epub-verify.h"
+
+#define VERIFY_BUFFER_LEN (64 * 1024)
+
+/* One archive of a batch, shared by the tasks verifying its ranges */
+typedef struct {
+    const char *path;
+    EpubVerifyResult *result;
+    zip_uint64_t first_bad_range; /* start of the range result->first_bad is from */
+    GMutex lock;
+} VerifyFile;
+
+/* Members [first, last) of file; last == 0 means "plan the split" */
+typedef struct {
+    VerifyFile *file;
+    zip_uint64_t first;
+    zip_uint64_t last;
+} VerifyTask;
+
+/* Per batch: tasks push more tasks, so completion is counted by hand */
+typedef struct {
+    GThreadPool *pool;
+    GMutex lock;
+    GCond done;
+    guint pending;
+} VerifyBatch;
+
+static gboolean verify_member(struct zip *za, zip_uint64_t index,
+                              guint8 *in, guint8 *out, guint64 *bytes,
+                              gboolean *skipped);
+static void verify_range(struct zip *za, zip_uint64_t first, zip_uint64_t last,
+                         EpubVerifyResult *result);
+static void verify_worker(gpointer data, gpointer user_data);
+
+/* Inflates one member and checks it against the central directory.
+   Returns FALSE if the member is damaged. */
+static gboolean
+verify_member(struct zip *za, zip_uint64_t index, guint8 *in, guint8 *out,
+              guint64 *bytes, gboolean *skipped)
+{
+    struct zip_stat sb;
+    zip_stat_init(&sb);
+    *skipped = FALSE;
+    if(zip_stat_index(za, index, 0, &sb) != 0
+       || !(sb.valid & ZIP_STAT_CRC) || !(sb.valid & ZIP_STAT_SIZE)
+       || !(sb.valid & ZIP_STAT_COMP_METHOD))
+        return FALSE;
+    if((sb.valid & ZIP_STAT_ENCRYPTION_METHOD)
+       && sb.encryption_method != ZIP_EM_NONE) {
+        *skipped = TRUE;
+        return TRUE;
+    }
+    /* Stored and deflated members are read raw and checked here, for the
+       rest libzip decompresses (and checks the CRC itself) */
+    const gboolean raw = sb.comp_method == ZIP_CM_STORE
+                         || sb.comp_method == ZIP_CM_DEFLATE;
+    const gboolean deflated = sb.comp_method == ZIP_CM_DEFLATE;
+    struct zip_file *zf = zip_fopen_index(za, index, raw ? ZIP_FL_COMPRESSED : 0);
+    if(!zf)
+        return FALSE;
+
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if(deflated && inflateInit2(&zs, -MAX_WBITS) != Z_OK) {
+        zip_fclose(zf);
+        return FALSE;
+    }
+    uLong crc = crc32(0L, NULL, 0);
+    guint64 size = 0;
+    gboolean ok = TRUE;
+    int zerr = deflated ? Z_OK : Z_STREAM_END;
+    for(;;) {
+        const zip_int64_t n = zip_fread(zf, in, VERIFY_BUFFER_LEN);
+        if(n < 0) {
+            ok = FALSE;
+            break;
+        }
+        if(n == 0)
+            break;
+        if(!deflated) {
+            crc = crc32(crc, in, (uInt)n);
+            size += n;
+            continue;
+        }
+        zs.next_in = in;
+        zs.avail_in = (uInt)n;
+        while(zs.avail_in > 0 && zerr == Z_OK) {
+            zs.next_out = out;
+            zs.avail_out = VERIFY_BUFFER_LEN;
+            zerr = inflate(&zs, Z_NO_FLUSH);
+            if(zerr != Z_OK && zerr != Z_STREAM_END && zerr != Z_BUF_ERROR)
+                break;
+            const uInt produced = VERIFY_BUFFER_LEN - zs.avail_out;
+            crc = crc32(crc, out, produced);
+            size += produced;
+            if(zerr == Z_BUF_ERROR)
+                zerr = Z_OK;
+        }
+        if(zerr != Z_OK && zerr != Z_STREAM_END) {
+            ok = FALSE;
+            break;
+        }
+    }
+    /* The deflate stream may hold output that needed no more input */
+    while(ok && deflated && zerr == Z_OK) {
+        zs.next_out = out;
+        zs.avail_out = VERIFY_BUFFER_LEN;
+        zerr = inflate(&zs, Z_NO_FLUSH);
+        const uInt produced = VERIFY_BUFFER_LEN - zs.avail_out;
+        crc = crc32(crc, out, produced);
+        size += produced;
+        if(produced == 0)
+            break;
+    }
+    if(deflated) {
+        /* A deflate stream that did not reach its end was truncated */
+        ok = ok && zerr == Z_STREAM_END;
+        inflateEnd(&zs);
+    }
+    if(zip_fclose(zf) != 0)
+        ok = FALSE;
+    *bytes += size;
+    return ok && size == sb.size && crc == sb.crc;
+}
+
+static void
+verify_range(struct zip *za, zip_uint64_t first, zip_uint64_t last,
+             EpubVerifyResult *result)
+{
+    guint8 *in = g_malloc(VERIFY_BUFFER_LEN);
+    guint8 *out = g_malloc(VERIFY_BUFFER_LEN);
+    for(zip_uint64_t i = first; i < last; ++i) {
+        gboolean skipped;
+        ++result->n_entries;
+        if(!verify_member(za, i, in, out, &result->bytes, &skipped)) {
+            ++result->n_bad;
+            if(!result->first_bad) {
+                const char *name = zip_get_name(za, i, 0);
+                result->first_bad = g_strdup(name ? name : "?");
+            }
+        } else if(skipped) {
+            ++result->n_skipped;
+        }
+    }
+    g_free(out);
+    g_free(in);
+}
+
+static struct zip *
+verify_open(const char *path, EpubVerifyResult *result)
+{
+    int err = 0;
+    struct zip *za = zip_open(path, ZIP_RDONLY, &err);
+    if(!za && !result->first_bad) {
+        char errbuf[MAX_STR_LEN];
+        zip_error_to_str(errbuf, sizeof(errbuf), err, errno);
+        result->first_bad = g_strdup(errbuf);
+    }
+    return za;
+}
+
+static void
+finish_status(EpubVerifyResult *result)
+{
+    epub_stats_add(EPUB_STAT_BYTES_VERIFIED, result->bytes);
+    if(result->status == EPUB_OK && result->n_bad)
+        result->status = EPUB_ERR_CORRUPT;
+}
+
+void
+epub_verify_archive(const char *path, EpubVerifyResult *result)
+{
+    memset(result, 0, sizeof(EpubVerifyResult));
+    struct zip *za = verify_open(path, result);
+    if(!za) {
+        result->status = EPUB_ERR_ZIP_OPEN;
+        return;
+    }
+    const zip_int64_t n = zip_get_num_entries(za, 0);
+    verify_range(za, 0, n > 0 ? (zip_uint64_t)n : 0, result);
+    zip_discard(za);
+    finish_status(result);
+}
+
+/* Batch */
+
+static void
+batch_push(VerifyBatch *batch, VerifyFile *file, zip_uint64_t first,
+           zip_uint64_t last)
+{
+    VerifyTask *task = g_new(VerifyTask, 1);
+    task->file = file;
+    task->first = first;
+    task->last = last;
+    g_mutex_lock(&batch->lock);
+    ++batch->pending;
+    g_mutex_unlock(&batch->lock);
+    g_thread_pool_push(batch->pool, task, NULL);
+}
+
+/* Splits the members into ranges of about EPUB_VERIFY_SPLIT inflated
+   bytes. All but the first are pushed, returns the end of the first. */
+static zip_uint64_t
+plan_ranges(VerifyBatch *batch, VerifyFile *file, struct zip *za,
+            zip_uint64_t n)
+{
+    zip_uint64_t first_end = 0, start = 0;
+    guint64 size = 0;
+    for(zip_uint64_t i = 0; i < n; ++i) {
+        struct zip_stat sb;
+        zip_stat_init(&sb);
+        if(zip_stat_index(za, i, 0, &sb) == 0 && (sb.valid & ZIP_STAT_SIZE))
+            size += sb.size;
+        if(size < EPUB_VERIFY_SPLIT && i + 1 < n)
+            continue;
+        if(first_end == 0)
+            first_end = i + 1;
+        else
+            batch_push(batch, file, start, i + 1);
+        start = i + 1;
+        size = 0;
+    }
+    return first_end;
+}
+
+static void
+verify_worker(gpointer data, gpointer user_data)
+{
+    VerifyTask *task = data;
+    VerifyBatch *batch = user_data;
+    VerifyFile *file = task->file;
+    EpubVerifyResult local;
+    memset(&local, 0, sizeof(local));
+    struct zip *za = verify_open(file->path, &local);
+    if(za) {
+        zip_uint64_t last = task->last;
+        if(last == 0) {
+            const zip_int64_t n = zip_get_num_entries(za, 0);
+            last = n > 0 ? plan_ranges(batch, file, za, (zip_uint64_t)n) : 0;
+        }
+        verify_range(za, task->first, last, &local);
+        zip_discard(za);
+    }
+
+    g_mutex_lock(&file->lock);
+    EpubVerifyResult *result = file->result;
+    if(!za)
+        result->status = EPUB_ERR_ZIP_OPEN;
+    result->n_entries += local.n_entries;
+    result->n_bad += local.n_bad;
+    result->n_skipped += local.n_skipped;
+    result->bytes += local.bytes;
+    /* Ranges finish in any order. They don't overlap and each reports
+       its lowest bad member, so the lowest range start wins. */
+    if(local.first_bad && task->first < file->first_bad_range) {
+        g_free(result->first_bad);
+        result->first_bad = local.first_bad;
+        local.first_bad = NULL;
+        file->first_bad_range = task->first;
+    }
+    g_mutex_unlock(&file->lock);
+    g_free(local.first_bad);
+    g_free(task);
+
+    g_mutex_lock(&batch->lock);
+    if(--batch->pending == 0)
+        g_cond_signal(&batch->done);
+    g_mutex_unlock(&batch->lock);
+}
+
+void
+epub_verify_archives(const char *const *paths, guint n_paths, guint n_threads,
+                     EpubVerifyResult *results)
+{
+    if(n_threads == 0)
+        n_threads = g_get_num_processors();
+    VerifyBatch batch;
+    g_mutex_init(&batch.lock);
+    g_cond_init(&batch.done);
+    batch.pending = 0;
+    batch.pool = g_thread_pool_new(verify_worker, &batch, n_threads, TRUE, NULL);
+    VerifyFile *files = g_new0(VerifyFile, n_paths);
+    for(guint i = 0; i < n_paths; ++i) {
+        memset(&results[i], 0, sizeof(EpubVerifyResult));
+        files[i].path = paths[i];
+        files[i].result = &results[i];
+        files[i].first_bad_range = G_MAXUINT64;
+        g_mutex_init(&files[i].lock);
+        batch_push(&batch, &files[i], 0, 0);
+    }
+    g_mutex_lock(&batch.lock);
+    while(batch.pending > 0)
+        g_cond_wait(&batch.done, &batch.lock);
+    g_mutex_unlock(&batch.lock);
+    g_thread_pool_free(batch.pool, FALSE, TRUE);
+
+    for(guint i = 0; i < n_paths; ++i) {
+        finish_status(&results[i]);
+        g_mutex_clear(&files[i].lock);
+    }
+    g_free(files);
+    g_cond_clear(&batch.done);
+    g_mutex_clear(&batch.lock);
+}
+
+void
+epub_verify_result_clear(EpubVerifyResult *result)
+{
+    g_free(result->first_bad);
+    result->first_bad = NULL;
+}
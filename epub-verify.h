@@ -0,0 +1,38 @@
+#ifndef _EPUB_VERIFY_
+#define _EPUB_VERIFY_
+
+#include <glib.h>
+
+/* Whole-archive integrity check: every member is inflated and its CRC32
+   and size compared with the central directory. The readers only touch
+   container.xml and the OPF, so a truncated or bit-rotted book otherwise
+   goes unnoticed until it is opened.
+
+   Members are read raw and inflated with zlib, whose crc32() uses the
+   CPU's carry-less multiply or CRC instructions where the build has them
+   (zlib-ng, zlib >= 1.3.1 on arm64). Other compression methods go
+   through libzip. Encrypted members are counted as skipped. */
+
+typedef struct {
+    int status;          /* EPUB_OK, EPUB_ERR_ZIP_OPEN or EPUB_ERR_CORRUPT */
+    guint n_entries;
+    guint n_bad;         /* CRC or size mismatch, truncated or undecodable */
+    guint n_skipped;     /* encrypted */
+    guint64 bytes;       /* inflated */
+    char *first_bad;     /* name of the bad member with the lowest index,
+                            or the open error */
+} EpubVerifyResult;
+
+/* One archive on the calling thread */
+void epub_verify_archive(const char *path, EpubVerifyResult *result);
+
+/* results[i] for paths[i]. Files are spread over n_threads workers (0 for
+   one per CPU); archives larger than EPUB_VERIFY_SPLIT uncompressed are
+   split into member ranges so one big book keeps all workers busy too. */
+#define EPUB_VERIFY_SPLIT (8 * 1024 * 1024)
+void epub_verify_archives(const char *const *paths, guint n_paths,
+                          guint n_threads, EpubVerifyResult *results);
+
+void epub_verify_result_clear(EpubVerifyResult *result);
+
+#endif /* _EPUB_VERIFY_ */
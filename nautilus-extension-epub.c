@@ -1,30 +1,31 @@
-#include <assert.h>
-#include <errno.h>
-
-#include <libxml/parser.h>
-
-#include <zip.h>
+#include <signal.h>
 #include <string.h>
-#ifdef DEBUG
-#include <stdio.h>
-#endif
+#include <sys/stat.h>
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <gio/gio.h>
+#include <glib-unix.h>
 #include <libnautilus-extension/nautilus-column-provider.h>
 #include <libnautilus-extension/nautilus-info-provider.h>
 
+#include "epub-format.h"
+#include "epub-index.h"
+#include "epub-reader.h"
+#include "epub-stats.h"
 #include "nautilus-extension-epub.h"
 
-typedef struct _EpubExtension EpubExtension;
-typedef struct _EpubExtensionClass EpubExtensionClass;
-
-typedef struct {
+struct _UpdateHandle {
     GClosure *update_complete;
     NautilusInfoProvider *provider;
     NautilusFileInfo *file;
-    int operation_handle;
-    gboolean cancelled;
-} UpdateHandle;
+    GFile *location;
+    GCancellable *cancellable;
+    char *mime_type;  /* hint for files the sniffer can't place */
+    /* Filled by epub_update_worker() */
+    EpubRecord *record;
+    int result;
+    gint64 queued_at;
+};
 
 struct _EpubExtension
 {
@@ -39,21 +40,119 @@ struct _EpubExtensionClass
 static GType provider_types[1];
 static GType epub_extension_type;
 
-/* Extension initialization */
+static guint epub_stats_signal;
+
+/* Set up on first use in two steps, most Nautilus sessions need neither.
+   A file that may be a book starts the workers, epub_extension_start();
+   the first real one the index, epub_extension_start_books(). libxml2 is
+   set up by the reader. Main thread only. */
+static gboolean epub_started;
+static GThreadPool *epub_pool;
+static GHashTable *epub_pending;  /* UpdateHandles not completed yet */
+static gboolean epub_books_started;
+/* NULL without a library index. Published with g_atomic_pointer_set(),
+   workers may already be running. */
+static EpubIndex *epub_index;
+
+/* Extension initialization. Nautilus loads every extension at startup,
+   so this only registers the type and the stats signal: until a handler
+   is installed SIGUSR2 terminates the process. */
 void
 nautilus_module_initialize (GTypeModule  *module)
 {
+    const gint64 start = epub_stats_now();
     epub_extension_register_type(module);
     provider_types[0] = epub_extension_get_type();
-    xmlInitParser();
-    LIBXML_TEST_VERSION
+    epub_stats_signal = g_unix_signal_add(SIGUSR2, epub_stats_signal_callback,
+                                          NULL);
+    epub_stats_record_since(EPUB_STAT_MODULE_INIT, start);
 }
 
 void
 nautilus_module_shutdown(void)
 {
     /* Any module-specific shutdown */
-    xmlCleanupParser();
+    if(epub_started) {
+        GHashTableIter iter;
+        gpointer handle;
+        /* Books still queued are skipped, running remote reads give up at
+           their next GVFS call; local reads are not interrupted */
+        g_hash_table_iter_init(&iter, epub_pending);
+        while(g_hash_table_iter_next(&iter, &handle, NULL))
+            g_cancellable_cancel(((UpdateHandle*)handle)->cancellable);
+        g_thread_pool_free(epub_pool, FALSE, TRUE);
+        /* Every worker has queued its timeout_epub_callback() now, the
+           main loop won't run them any more */
+        g_hash_table_iter_init(&iter, epub_pending);
+        while(g_hash_table_iter_next(&iter, &handle, NULL)) {
+            g_idle_remove_by_data(handle);
+            update_handle_free(handle);
+        }
+        g_hash_table_destroy(epub_pending);
+    }
+    if(epub_books_started)
+        epub_index_close(epub_index);
+    g_source_remove(epub_stats_signal);
+    epub_reader_cleanup();
+    if(g_getenv(EPUB_STATS_ENV))
+        epub_stats_signal_callback(NULL);
+}
+
+/* The workers, for any file that may be a book. A plain zip or XML file
+   gets no further than this. */
+static void
+epub_extension_start(void)
+{
+    const gint64 start = epub_stats_now();
+    epub_pool = g_thread_pool_new(epub_update_worker, NULL, EPUB_MAX_WORKERS,
+                                  FALSE, NULL);
+    epub_pending = g_hash_table_new(g_direct_hash, g_direct_equal);
+    epub_started = TRUE;
+    epub_stats_record_since(EPUB_STAT_FIRST_USE, start);
+}
+
+/* The library index, once a file has a book MIME type or turned out to
+   be a book. It is only mapped, records are read by the workers. */
+static void
+epub_extension_start_books(void)
+{
+    const gint64 start = epub_stats_now();
+    GError *error = NULL;
+    char *filename = g_getenv(EPUB_INDEX_ENV)
+                     ? g_strdup(g_getenv(EPUB_INDEX_ENV))
+                     : g_build_filename(g_get_user_cache_dir(),
+                                        "nautilus-extension-epub.idx", NULL);
+    EpubIndex *index = epub_index_open(filename, &error);
+    if(index) {
+        g_atomic_pointer_set(&epub_index, index);
+    } else {
+        /* Not having one is the normal case */
+        if(!g_error_matches(error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+            g_warning("EpubExtension: %s", error->message);
+        g_error_free(error);
+    }
+    g_free(filename);
+    epub_books_started = TRUE;
+    epub_stats_record_since(EPUB_STAT_FIRST_USE, start);
+}
+
+/* kill -USR2 $(pidof nautilus) writes the counters as JSON to
+   $EPUB_STATS_FILE, or to the user cache directory */
+static gboolean
+epub_stats_signal_callback(gpointer user_data)
+{
+    GError *error = NULL;
+    char *filename = g_getenv(EPUB_STATS_ENV)
+                     ? g_strdup(g_getenv(EPUB_STATS_ENV))
+                     : g_build_filename(g_get_user_cache_dir(),
+                                        "nautilus-extension-epub-stats.json",
+                                        NULL);
+    if(!epub_stats_dump(filename, &error)) {
+        g_warning("EpubExtension: %s", error->message);
+        g_error_free(error);
+    }
+    g_free(filename);
+    return G_SOURCE_CONTINUE;
 }
 
 void
@@ -186,7 +285,43 @@ epub_extension_cancel_update(NautilusInfoProvider *provider,
                              NautilusOperationHandle *handle)
 {
     UpdateHandle *update_handle = (UpdateHandle*)handle;
-    update_handle->cancelled = TRUE;
+    /* Also aborts a GVFS read that is still in flight */
+    g_cancellable_cancel(update_handle->cancellable);
+}
+
+static void
+epub_extension_add_attributes(NautilusFileInfo *file, const EpubRecord *record)
+{
+    nautilus_file_info_add_string_attribute(file,
+                                            "EpubExtension::epub_title",
+                                            epub_record_title(record));
+    nautilus_file_info_add_string_attribute(file,
+                                            "EpubExtension::epub_lang",
+                                            epub_record_lang(record));
+    if(record->n_creators <= 1) {
+        nautilus_file_info_add_string_attribute(file,
+                                                "EpubExtension::epub_creator",
+                                                record->n_creators
+                                                ? epub_record_creator(record, 0)
+                                                : "");
+        return;
+    }
+    char *creators = epub_record_join_creators(record, ", ");
+    nautilus_file_info_add_string_attribute(file,
+                                            "EpubExtension::epub_creator",
+                                            creators);
+    g_free(creators);
+}
+
+/* Publish the columns and keep the record on the file object so that we
+   don't have to read the book again. Takes ownership of record: one
+   allocation per book, the strings are not copied. */
+static void
+epub_extension_set_info(NautilusFileInfo *file, EpubRecord *record)
+{
+    epub_extension_add_attributes(file, record);
+    g_object_set_data_full(G_OBJECT(file), "EpubExtension::epub_record",
+                           record, g_free);
 }
 
 static NautilusOperationResult
@@ -197,94 +332,124 @@ epub_extension_update_file_info(NautilusInfoProvider *provider,
 {
     if(nautilus_file_info_is_directory(file))
         return NAUTILUS_OPERATION_COMPLETE;
-    if(!nautilus_file_info_is_mime_type(file, "application/epub+zip"))
+    /* The format is decided by the content, a generic zip or xml type
+       may still be a book */
+    char *mime_type = nautilus_file_info_get_mime_type(file);
+    if(!epub_format_is_candidate(mime_type)
+       || g_object_get_data(G_OBJECT(file), "EpubExtension::not_a_book")) {
+        g_free(mime_type);
         return NAUTILUS_OPERATION_COMPLETE;
-    //char *title = nautilus_file_info_get_string_attribute(file, "EpubExtension::epub_title");
-    char *title = g_object_get_data(G_OBJECT(file), "EpubExtension::epub_title");
-    char *lang = g_object_get_data(G_OBJECT(file), "EpubExtension::epub_lang");
-    char *creator = g_object_get_data(G_OBJECT(file), "EpubExtension::epub_creator");
+    }
+    const gint64 start = epub_stats_now();
+    const EpubRecord *record = g_object_get_data(G_OBJECT(file),
+                                                 "EpubExtension::epub_record");
 
     /* get and provide the information associated with the column.
        If the operation is not fast enough, we should use the arguments 
        update_complete and handle for asyncrhnous operation. */
-    if (!title) {
+    if (!record) {
+        if(!epub_started)
+            epub_extension_start();
+        if(!epub_books_started && epub_format_is_book_type(mime_type))
+            epub_extension_start_books();
         UpdateHandle *update_handle = g_new0(UpdateHandle, 1);
         update_handle->update_complete = g_closure_ref(update_complete);
         update_handle->provider = provider;
         update_handle->file = g_object_ref(file);
-        //g_timeout_add (1, 
-        g_idle_add(
-                timeout_epub_callback, 
-                update_handle);
-        *handle = update_handle;
+        /* NautilusFileInfo is not thread safe, resolve it here */
+        update_handle->location = nautilus_file_info_get_location(file);
+        update_handle->cancellable = g_cancellable_new();
+        update_handle->mime_type = mime_type;
+        update_handle->queued_at = epub_stats_now();
+        g_hash_table_add(epub_pending, update_handle);
+        g_thread_pool_push(epub_pool, update_handle, NULL);
+        *handle = (NautilusOperationHandle*)update_handle;
+        epub_stats_add(EPUB_STAT_CACHE_MISSES, 1);
+        epub_stats_record_since(EPUB_STAT_MAIN_LOOP, start);
         return NAUTILUS_OPERATION_IN_PROGRESS;
     }
-    nautilus_file_info_add_string_attribute(file,
-                                            "EpubExtension::epub_title",
-                                            title);
-    nautilus_file_info_add_string_attribute(handle->file,
-                                            "EpubExtension::epub_lang",
-                                            lang);
-    nautilus_file_info_add_string_attribute(handle->file,
-                                            "EpubExtension::epub_creator",
-                                            creator);
+    g_free(mime_type);
+    epub_stats_add(EPUB_STAT_CACHE_HITS, 1);
+    epub_extension_add_attributes(file, record);
+    epub_stats_record_since(EPUB_STAT_MAIN_LOOP, start);
     return NAUTILUS_OPERATION_COMPLETE;
 }
 
+/* Runs in epub_pool: reading a book on a network share can take
+   seconds, that must not happen on the main loop */
+static void
+epub_update_worker(gpointer data, gpointer user_data)
+{
+    UpdateHandle *handle = (UpdateHandle*)data;
+    epub_stats_record_since(EPUB_STAT_QUEUE_WAIT, handle->queued_at);
+    if (!g_cancellable_is_cancelled(handle->cancellable)) {
+        char *filename = g_file_get_path(handle->location);
+        if(filename && epub_update_from_index(handle, filename))
+            epub_stats_add(EPUB_STAT_INDEX_HITS, 1);
+        else if(filename)
+            handle->result = read_book(filename, handle->mime_type,
+                                       &handle->record);
+        else
+            /* SMB, SFTP, WebDAV...: fetch only the ranges we need */
+            handle->result = read_book_file(handle->location, handle->mime_type,
+                                            handle->cancellable,
+                                            &handle->record, NULL);
+        g_free(filename);
+    }
+    g_idle_add(timeout_epub_callback, handle);
+}
 
-/* Callback for async */
+/* The book as `epub-tool index` last saw it, if it hasn't changed since
+   and its record is intact. Touches only this entry's pages of the
+   mapping. */
+static gboolean
+epub_update_from_index(UpdateHandle *handle, const char *filename)
+{
+    GStatBuf st;
+    const EpubIndex *index = g_atomic_pointer_get(&epub_index);
+    const EpubIndexRecord *record = index ? epub_index_find(index, filename)
+                                          : NULL;
+    if(!record || !epub_index_book_is_valid(index, record)
+       || g_stat(filename, &st) != 0
+       || record->mtime != st.st_mtime || record->size != st.st_size)
+        return FALSE;
+    handle->result = record->status;
+    handle->record = epub_record_copy(epub_index_get_book(index, record));
+    return TRUE;
+}
+
+/* Callback for async, back on the main loop */
 gint
 timeout_epub_callback(gpointer data)
 {
     UpdateHandle *handle = (UpdateHandle*)data;
-    if (!handle->cancelled) {
-        char *filename = g_file_get_path(nautilus_file_info_get_location(handle->file));
-        EpubInfo info;
-        const int result = read_from_epub(filename, &info);
-        if(result == 0) {
-            nautilus_file_info_add_string_attribute(handle->file,
-                                                    "EpubExtension::epub_title",
-                                                     info.title);
-            nautilus_file_info_add_string_attribute(handle->file,
-                                                    "EpubExtension::epub_lang",
-                                                     info.lang);
-            nautilus_file_info_add_string_attribute(handle->file,
-                                                    "EpubExtension::epub_creator",
-                                                     info.creator);
-        
-            /* Cache the data so that we don't have to read it again */
-            g_object_set_data(G_OBJECT (handle->file), 
-                                            "EpubExtension::epub_title",
-                                            info.title);
-
-            g_object_set_data(G_OBJECT (handle->file), 
-                                            "EpubExtension::epub_lang",
-                                            info.lang);
-            g_object_set_data(G_OBJECT (handle->file), 
-                                            "EpubExtension::epub_creator",
-                                            info.creator);
-        } else {
-            if(result == 1) {
-                nautilus_file_info_add_string_attribute (handle->file,
-                                                        "EpubExtension::epub_title",
-                                                         info.title);
-                char *data_s = g_strdup_printf("%s", info.title);
-                g_object_set_data(G_OBJECT(handle->file), 
-                                        "EpubExtension::epub_title",
-                                        data_s);
-                g_free(data_s)
-            } else {
-                char *data_s = g_strdup_printf("%s, Code: %d", epub_errors[result], result);
-                nautilus_file_info_add_string_attribute (handle->file,
-                                                        "EpubExtension::epub_title",
-                                                         data_s);
-                g_object_set_data(G_OBJECT(handle->file), 
-                                        "EpubExtension::epub_title",
-                                        data_s);
-                g_free(data_s)
-            }
+    const gint64 start = epub_stats_now();
+    const gboolean cancelled = g_cancellable_is_cancelled(handle->cancellable);
+    const gboolean generic = !epub_format_is_book_type(handle->mime_type);
+    if (!cancelled && generic && handle->result == EPUB_ERR_FORMAT) {
+        /* An ordinary zip or XML file, leave its columns empty and don't
+           sniff it again */
+        g_object_set_data(G_OBJECT(handle->file), "EpubExtension::not_a_book",
+                          GINT_TO_POINTER(TRUE));
+    } else if (!cancelled && generic && handle->result == EPUB_ERR_ZIP_OPEN) {
+        /* Could not be read, so nothing is known about it. No error text
+           on what is most likely an ordinary file; try again next time. */
+    } else if (!cancelled && handle->record) {
+        /* A book MIME type, or a generic one that held a book after all */
+        if(!epub_books_started && generic)
+            epub_extension_start_books();
+        if(handle->result != EPUB_OK && handle->result != EPUB_ERR_ZIP_OPEN) {
+            /* Show the error instead of half the metadata */
+            char *data_s = g_strdup_printf("%s, Code: %d",
+                                           epub_strerror(handle->result),
+                                           handle->result);
+            g_free(handle->record);
+            handle->record = epub_record_new(data_s, NULL, NULL, 0, NULL, 0,
+                                             0, 0);
+            g_free(data_s);
         }
-        g_free(filename);
+        epub_extension_set_info(handle->file, handle->record);
+        handle->record = NULL;
     }
     
     nautilus_info_provider_update_complete_invoke
@@ -293,337 +458,23 @@ timeout_epub_callback(gpointer data)
                                                  (NautilusOperationHandle*)handle,
                                                  NAUTILUS_OPERATION_COMPLETE);
     /* We're done with the handle */
-    g_closure_unref(handle->update_complete);
-    g_object_unref(handle->file);
-    g_free(handle);
-    return 0;
-}
-/* Epub */
-
-static int
-read_from_epub(const char *archive, EpubInfo *info)
-{
-    int result = 0; /* Result for operation */
-    /* Zip error */
-    int err = 0;
-    char errbuf[MAX_STR_LEN];
-    char *dataEntry;
-    /* Zip */
-    struct zip *za;
-    struct zip_file *zf;
-    struct zip_stat sb;
-    /* For files in zip */
-    zip_int64_t num64; /* Number of files */
-    zip_uint64_t i;    /* Counter, for 0..num64 */
-    zip_uint64_t uncomp_size; /* Zize of uncompressed file */
-    zip_int64_t fread_len; /* Really read bytes from zipped file. */
-    int len;
-    za = zip_open(archive, 0, &err);
-    if (za == NULL) {
-        zip_error_to_str(errbuf, sizeof(errbuf), err, errno);
-        strncpy(info->title, errbuf, MAX_STR_LEN);
-        return 1;
-    }
-    /*Read container.xml*/
-    zf = zip_fopen(za, "META-INF/container.xml", ZIP_FL_COMPRESSED);
-    if(!zf) {
-        zip_close(za);
-        return 2;
-    }
-    AboutContainer container;
-    container.my_state == INIT;
-    char buffer[ZIP_BUFFER_LEN];
-    memset(&container, 0, sizeof(AboutContainer));
-    memset(buffer, 0, sizeof(buffer));
-    xmlSAXHandler SAXHander;
-    make_sax_handler_container(&SAXHander, &container);
- 
-    fread_len = zip_fread(zf, buffer, sizeof(buffer));
-    if(fread_len <= 0) {
-        zip_fclose(zf);
-        zip_close(za);
-        return(3);
-    }
-    xmlParserCtxtPtr ctxt = xmlCreatePushParserCtxt(
-        &SAXHander, NULL, buffer, fread_len, NULL
-    );    
-    while(container.my_state != STOP) {
-        fread_len = zip_fread(zf, buffer, sizeof(buffer));
-        if(fread_len <= 0)
-            break;
-        if(xmlParseChunk(ctxt, buffer, fread_len, 0)) {
-            xmlParserError(ctxt, "xmlParseChunk");
-            zip_fclose(zf);
-            zip_close(za);
-            return 3;
-        }
-    }
-    zip_fclose(zf);
-    /* Read book info */
-    zf = zip_fopen(za, container.contentFilename, ZIP_FL_COMPRESSED);
-    if(!zf) {
-        zip_close(za);
-        return(3);
-    }
-    fread_len = zip_fread(zf, buffer, sizeof(buffer));
-    if(fread_len <= 0) {
-        zip_fclose(zf);
-        zip_close(za);
-        return(3);
-    }
-    make_sax_handler_contentOPF(&SAXHander, info);
-    info.my_state = INIT;
-    xmlParserCtxtPtr ctxt2 = xmlCreatePushParserCtxt(
-        &SAXHander, NULL, buffer, fread_len, NULL
-    );    
-    while(info.my_state != STOP) {
-        fread_len = zip_fread(zf, buffer, sizeof(buffer));
-        if(fread_len <= 0)
-            break;
-        if(xmlParseChunk(ctxt2, buffer, fread_len, 0)) {
-            xmlParserError(ctxt2, "xmlParseChunk");
-            zip_fclose(zf);
-            zip_close(za);
-            return 4;
-        }
-    }
-    zip_fclose(zf);
-    /* End */
-    if (zip_close(za) == -1) {
-        return 5;
-    }
-    return result;
-}
-
-static void
-make_sax_handler_container(xmlSAXHandler *SAXHander,
-                           void *user_data)
-{
-    memset(SAXHander, 0, sizeof(xmlSAXHandler));
-    SAXHander->initialized = XML_SAX2_MAGIC;
-    SAXHander->startElementNs = OnStartElementContainerNs;
-    SAXHander->_private = user_data;
-}
-
-static void
-make_sax_handler_contentOPF(xmlSAXHandler *SAXHander,
-                            void *user_data)
-{
-    memset(SAXHander, 0, sizeof(xmlSAXHandler));
-    SAXHander->initialized = XML_SAX2_MAGIC;
-    SAXHander->startElementNs = OnStartElementNs;
-    SAXHander->endElementNs = OnEndElementNs;
-    SAXHander->characters = OnCharacters;
-    SAXHander->_private = user_data;
-}
-
-static void
-my_strlcpy(char *dest, const char *src_begin, const char *src_end, size_t count)
-{
-    size_t i = 0;
-    //for(char *a=(char *)src_begin; a < src_end && i < count; ++a, ++i)
-    //dest[i] = *a;
-    for(; src_begin < src_end && i < count; ++src_begin, ++i, ++dest)
-        *dest = *src_begin;
-}
-
-static int
-my_strncmp(const char *lhs, const char *rhs_begin, const char *rhs_end, size_t count)
-{
-    /*See: http://cmcmsu.no-ip.info/2course/strcmp.feature.htm */
-    for(size_t i = 0; rhs_begin! = rhs_end && i < count; ++i, ++lhs, ++rhs_begin) {
-        if((unsigned char)*lhs != (unsigned char)*rhs_begin)
-            return -1;
-    }
+    g_hash_table_remove(epub_pending, handle);
+    update_handle_free(handle);
+    epub_stats_record_since(EPUB_STAT_MAIN_LOOP, start);
     return 0;
 }
 
 static void
-OnStartElementContainerNs(
-    void *ctx,
-    const xmlChar *localname,
-    const xmlChar *prefix,
-    const xmlChar *URI,
-    int nb_namespaces,
-    const xmlChar **namespaces,
-    int nb_attributes,
-    int nb_defaulted,
-    const xmlChar **attributes
-    )
+update_handle_free(UpdateHandle *handle)
 {
-    #ifdef DEBUG
-    fprintf (stderr, "Event: OnStartElementContainerNs!\n");
-    #endif
-    char media_type[MAX_STR_LEN];
-    memset(media_type, 0, sizeof(media_type));
-    xmlSAXHandlerPtr handler = ((xmlParserCtxtPtr)ctx)->sax;
-    AboutContainer *container = (AboutContainer *)(handler->_private);
-    char *fname = (char *)(handler->_private);
-    if(g_strcmp0((const char*)localname, "rootfile") == 0) {
-        size_t index = 0;
-        for(int indexAttr = 0;
-            indexAttr < nb_attributes;
-            ++indexAttr, index += 5) {
-            const xmlChar *a_localname = attributes[index];
-            const xmlChar *a_prefix = attributes[index+1];
-            const xmlChar *a_nsURI = attributes[index+2];
-            const xmlChar *a_valueBegin = attributes[index+3];
-            const xmlChar *a_valueEnd = attributes[index+4];
-            if(g_strcmp0((const char*)a_localname, "full-path") == 0) {
-                my_strlcpy(AboutContainer->contentFilename, (const char *)a_valueBegin, (const char *)a_valueEnd, MAX_STR_LEN);
-            }
-            /*
-            if(g_strcmp0((const char*)a_localname, "media-type") == 0) {
-                my_strlcpy(media_type, (const char *)valueBegin, (const char *)valueEnd, MAX_STR_LEN);
-                media_type_flag = 1;
-            }
-            */
-            if( g_strcmp0((const char*)a_localname, "media-type") == 0 &&
-                my_strncmp("application/oebps-package+xml", (const char *)a_valueBegin, (const char *)a_valueEnd, MAX_STR_LEN) == 0
-                ) {
-                container->my_state = STOP;
-            }
-        }
-    }
-    /*
-    if(g_strcmp0((const char*)media_type, "application/oebps-package+xml") == 0) {
-        xmlStopParser(ctx);
-    }
-    */
-}
-
-static inline int 
-max(int a, int b)
-{
-    if(a > b)
-        return a;
-    return b;
-}
-
-static inline int 
-min(int a, int b)
-{
-    if(a < b)
-        return a;
-    return b;
-}
-
-static void
-my_strlcat_names(char *dest, size_t count, const char *src, size_t count2)
-{
-    size_t id = 0;
-    char *d = dest;
-    while(d != '\0') {
-        ++d;
-        ++id;
-    }
-    if(d != dest) {
-        if(id!=count) {
-            *d = ',';
-            ++d;
-            ++id;
-        }
-        if(id!=count) {
-            *d = ' ';
-            ++d;
-            ++id;
-        }
-    }
-    for(size_t is = 0; is < count2 && id < count && *src!='\0'; ++d, ++id, ++is, ++src)
-        *d = *src;
-    dest[count-1] = '\0';
-}
-
-static void
-OnCharacters(void * ctx,
-    const xmlChar * ch,
-    int len)
-{
-    #ifdef DEBUG
-    fprintf(stderr, "Event: OnCharacters!\n");
-    #endif
-    xmlSAXHandlerPtr handler = ((xmlParserCtxtPtr)ctx)->sax;
-    EpubInfo *info = (EpubInfo *)(handler->_private);
-    switch (info->my_state) {
-    case CREATOR_OPENED: {
-        const int len2 = min(len, MAX_STR_LEN);
-        my_strlcat_names(info->creator, MAX_STR_LEN, (const char *)ch, len2);
-        /* https://developer.gnome.org/glib/stable/glib-String-Utility-Functions.html#g-strlcat */
-        //g_strlcat(info->creator, (const char *)ch, len2);
-        /* Since C11 */
-        /* strncat_s(info->creator, MAX_STR_LEN, (const char *)ch, MAX_STR_LEN); */
-        info->my_state = CREATOR_END;
-        }
-        break;
-    case BOOK_TITLE_OPENED: {
-        const int len2 = min(len, MAX_STR_LEN);
-        strncpy(info->title, (const char *)ch, len2);
-        info->my_state = BOOK_TITLE_END;
-        }
-        break;
-    case LANG_OPENED: {
-        const int len2 = min(len, LANG_LENGTH);
-        strncpy(info->lang, (const char *)ch, len2);
-        info->my_state = LANG_END;
-        }
-        break;
-    default:
-        break;
-    }
-}
-
-static void
-OnStartElementNs(
-    void *ctx,
-    const xmlChar *localname,
-    const xmlChar *prefix,
-    const xmlChar *URI,
-    int nb_namespaces,
-    const xmlChar **namespaces,
-    int nb_attributes,
-    int nb_defaulted,
-    const xmlChar **attributes
-    )
-{
-    #ifdef DEBUG
-    fprintf (stderr, "Event: OnStartElementNs!\n");
-    #endif
-    xmlSAXHandlerPtr handler = ((xmlParserCtxtPtr)ctx)->sax;
-    EpubInfo *info = (EpubInfo *)(handler->_private);
-    info->my_state = INIT;
-    if (g_strcmp0((const char*)localname, "creator") == 0) {
-        info->my_state = CREATOR_OPENED;
-        return;
-    }
-    if (g_strcmp0((const char*)localname, "language") == 0) {
-        info->my_state = LANG_OPENED;
-        return;
-    }
-    if (g_strcmp0((const char*)localname, "title") == 0) {
-        info->my_state = BOOK_TITLE_OPENED;
-        return;
-    }
-}
-
-static void
-OnEndElementNs(
-    void* ctx,
-    const xmlChar* localname,
-    const xmlChar* prefix,
-    const xmlChar* URI
-    )
-{
-    #ifdef DEBUG
-    fprintf (stderr, "Event: OnEndElementNs!\n");
-    #endif
-    xmlSAXHandlerPtr handler = ((xmlParserCtxtPtr)ctx)->sax;
-    EpubInfo *info = (EpubInfo *)(handler->_private);
-    if (g_strcmp0((const char*)localname, "metadata") == 0) {
-        info->my_state = STOP;
-        xmlStopParser(ctx);
-    }
+    g_closure_unref(handle->update_complete);
+    g_object_unref(handle->file);
+    g_object_unref(handle->location);
+    g_object_unref(handle->cancellable);
+    g_free(handle->mime_type);
+    g_free(handle->record);
+    g_free(handle);
 }
-
 #ifdef PROPERTY
 static GList *
 epub_extension_get_pages (NautilusPropertyPageProvider *provider,
@@ -697,7 +548,7 @@ epub_extension_get_pages (NautilusPropertyPageProvider *provider,
                                         info.title);
                 title = info.title;
             } else {
-                char *data_s = g_strdup_printf("%s, Code: %d", epub_errors[result], result);
+                char *data_s = g_strdup_printf("%s, Code: %d", epub_strerror(result), result);
                 nautilus_file_info_add_string_attribute (handle->file,
                                                         "EpubExtension::epub_title",
                                                          data_s);
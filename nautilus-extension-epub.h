@@ -1,9 +1,16 @@
 #ifndef _NAUTILUS_EXTENSION_EPUB_
 #define _NAUTILUS_EXTENSION_EPUB_
 
+typedef struct _EpubExtension EpubExtension;
+typedef struct _EpubExtensionClass EpubExtensionClass;
+typedef struct _UpdateHandle UpdateHandle;
+
 void nautilus_module_initialize(GTypeModule *module);
 void nautilus_module_shutdown(void);
 void nautilus_module_list_types(const GType **types, int *num_types);
+static void epub_extension_start(void);
+static void epub_extension_start_books(void);
+static gboolean epub_stats_signal_callback(gpointer user_data);
 static void epub_extension_column_provider_iface_init(
                                 NautilusColumnProviderIface *iface);
 static void epub_extension_info_provider_iface_init(
@@ -29,79 +36,19 @@ static NautilusOperationResult epub_extension_update_file_info (
                                 GClosure *update_complete,
                                 NautilusOperationHandle **handle);
 
+static void epub_extension_add_attributes(NautilusFileInfo *file,
+                                          const EpubRecord *record);
+static void epub_extension_set_info(NautilusFileInfo *file, EpubRecord *record);
+
+/* Readers in flight; remote locations spend most of their time waiting */
+#define EPUB_MAX_WORKERS 4
+/* Library index used as a persistent cache, default
+   $XDG_CACHE_HOME/nautilus-extension-epub.idx */
+#define EPUB_INDEX_ENV "EPUB_INDEX_FILE"
+static void epub_update_worker(gpointer data, gpointer user_data);
+static gboolean epub_update_from_index(UpdateHandle *handle,
+                                       const char *filename);
 gint timeout_epub_callback(gpointer data);
-
-/* ------- Start Epub only */
-#define MAX_STR_LEN 256
-#define ZIP_BUFFER_LEN 1024
-
- enum FSM_State {
-    INIT,
-    BOOK_TITLE_OPENED,
-    BOOK_TITLE_END,
-    CREATOR_OPENED,
-    CREATOR_END,
-    LANG_OPENED,
-    LANG_END,
-    STOP
-};
-
-#define LANG_LENGTH 6
-typedef struct {
-    char title[MAX_STR_LEN];
-    char creator[MAX_STR_LEN];
-    char lang[LANG_LENGTH];
-    enum FSM_State my_state;
-} EpubInfo;
-
-
-typedef struct {
-    char contentFilename[MAX_STR_LEN];
-    enum FSM_State my_state;
-} AboutContainer;
-        
-static int read_from_epub(const char *archive, EpubInfo *info);
-
-static void make_sax_handler_container(xmlSAXHandler *SAXHander, void *user_data);
-static void make_sax_handler_contentOPF(xmlSAXHandler *SAXHander, void *user_data);
-static void OnStartElementNs(
-    void *ctx,
-    const xmlChar *localname,
-    const xmlChar *prefix,
-    const xmlChar *URI,
-    int nb_namespaces,
-    const xmlChar **namespaces,
-    int nb_attributes,
-    int nb_defaulted,
-    const xmlChar **attributes
-    );
-static void OnStartElementContainerNs(
-    void *ctx,
-    const xmlChar *localname,
-    const xmlChar *prefix,
-    const xmlChar *URI,
-    int nb_namespaces,
-    const xmlChar **namespaces,
-    int nb_attributes,
-    int nb_defaulted,
-    const xmlChar **attributes
-    );
-
-static void OnEndElementNs(
-    void* ctx,
-    const xmlChar* localname,
-    const xmlChar* prefix,
-    const xmlChar* URI
-    );
-
-static void OnCharacters(void *ctx, const xmlChar *ch, int len);
-
-const static char *epub_errors[] = {"ok", "ZIP read error", "ZIP inner file open error",
-                                    "Epub container.xml file parse XML error",
-                                    "Epub OPF file parse XML error",
-                                    "can't close zip archive"};
-
-static void my_strlcpy(char *dest, const char *src_begin, const char *src_end, size_t count);
-static int my_strncmp(const char *lhs, const char *rhs_begin, const char *rhs_end, size_t count);
+static void update_handle_free(UpdateHandle *handle);
 
 #endif /* _NAUTILUS_EXTENSION_EPUB_ */